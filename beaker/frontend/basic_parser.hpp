@@ -0,0 +1,1052 @@
+#ifndef BEAKER_FRONTEND_BASIC_PARSER_HPP
+#define BEAKER_FRONTEND_BASIC_PARSER_HPP
+
+#include <beaker/language/parallel.hpp>
+#include <beaker/language/trace.hpp>
+#include <beaker/frontend/parser.hpp>
+#include <beaker/frontend/incremental.hpp>
+
+#include <optional>
+#include <vector>
+#include <utility>
+
+namespace beaker
+{
+  /// The grammar shared by the experimental language parsers. This is a CRTP
+  /// class. D is the language parser, which customizes the grammar by hiding
+  /// the hooks below with its own productions.
+  ///
+  /// Hooks are always called through `derived()`, so they are dispatched
+  /// statically, and can be inlined into the productions that use them. Each
+  /// language explicitly instantiates its grammar in its own translation
+  /// unit.
+  template<typename D>
+  struct Basic_parser : Parser
+  {
+    using Parser::Parser;
+
+    D* derived()
+    {
+      return static_cast<D*>(this);
+    }
+
+    // Top-level.
+    Syntax* parse_file() override;
+    Syntax* parse_next() override;
+    Syntax* reparse(Syntax* old, Token_stream const& prev) override;
+    Syntax* parse_deferred(std::size_t pos) override;
+    std::shared_ptr<Parser> copy() const override;
+
+    // Declarations.
+    Syntax* parse_declaration(); // hook
+    Syntax* parse_definition();
+    Syntax* parse_parameter();
+    Syntax* parse_declaration_seq();
+    Syntax* parse_declaration_seq_parallel();
+
+    // Declarators.
+    Syntax* parse_declarator(); // hook
+    Syntax* parse_declarator_list();
+
+    // Types.
+    Syntax* parse_type(); // hook
+
+    // Expressions, in general.
+    Syntax* parse_expression(); // hook
+
+    // Infix expressions. These are parsed by a single operator-precedence
+    // parser driven by `m_infix`. The named productions start parsing at
+    // their precedence level.
+    Syntax* parse_infix_expression();
+    Syntax* parse_assignment_expression();
+    Syntax* parse_implication_expression();
+    Syntax* parse_logical_or_expression();
+    Syntax* parse_logical_and_expression();
+    Syntax* parse_equality_expression();
+    Syntax* parse_relational_expression();
+    Syntax* parse_additive_expression();
+    Syntax* parse_multiplicative_expression();
+    Syntax* parse_binary_expression(Precedence min);
+
+    // Prefix expressions.
+    Syntax* parse_prefix_expression(); // hook
+
+    // Postfix expressions.
+    Syntax* parse_postfix_expression(); // hook
+
+    // Primary expressions.
+    Syntax* parse_primary_expression(); // hook
+    Syntax* parse_tuple_expression();
+    Syntax* parse_list_expression();
+    Syntax* parse_id_expression();
+
+    // Helper grammars
+    Syntax* parse_paren_list();
+    Syntax* parse_paren_group();
+    Syntax* parse_bracket_list();
+    Syntax* parse_bracket_group();
+    Syntax* parse_expression_group();
+    Syntax* parse_expression_list();
+    Syntax* parse_brace_list();
+    Syntax* parse_deferred_brace_list();
+
+    // Statements
+    Syntax* parse_statement(std::size_t n); // hook
+    Syntax* parse_declaration_statement(std::size_t n);
+    Syntax* parse_expression_statement(std::size_t n);
+    Syntax* parse_statement_seq();
+
+    Syntax* parse_parameter_or_expression();
+
+    /// Parse a list enclosed by the tokens of E. Note that a list
+    /// is comprised of groups, so that's allowed.
+    template<Enclosure E, typename F>
+    Syntax* parse_enclosed(F fn)
+    {
+      return nested([this, fn] {
+        return parse_enclosure<E>(fn);
+      });
+    }
+
+    template<Enclosure E, typename F>
+    Syntax* parse_enclosure(F fn)
+    {
+      Token open = require(open_token(E));
+      Syntax* t = nullptr;
+      if (next_token_is_not(close_token(E)))
+        t = (this->*fn)();
+      Token close = expect(close_token(E));
+      return new Enclosure_syntax(open, close, t);
+    }
+  };
+
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_file()
+  {
+    Syntax* s = parse_declaration_seq();
+    return new File_syntax(s);
+  }
+
+  /// Parses the next declaration. When parsing a stream, a declaration that
+  /// runs past the start of the next one is parsed again with the tokens of
+  /// both.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_next()
+  {
+    if (m_source && m_pos >= m_limit)
+      release_tokens();
+    if (eof())
+      return nullptr;
+
+    Trace_span span(m_trans.trace(), "declaration", "line", input_location().line);
+    bool lazy = std::exchange(m_lazy, m_lazy && !m_source);
+    Diagnostic_sink diags;
+    Diagnostic_sink* outer = std::exchange(m_diags, &diags);
+    std::size_t start = m_pos;
+    Syntax* s;
+    while (true) {
+      m_recovering = false;
+      s = derived()->parse_declaration();
+      if (!m_source || m_pos <= m_limit)
+        break;
+      diags.m_diags.clear();
+      m_pos = start;
+      extend_tokens(m_limit);
+    }
+    m_diags = outer;
+    m_lazy = lazy;
+
+    for (Diagnostic const& diag : diags.diagnostics())
+      m_diags->error(diag.location, diag.message);
+    return s;
+  }
+
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_declaration_seq()
+  {
+    if (m_source) {
+      Syntax_seq ss;
+      while (Syntax* s = parse_next())
+        ss.push_back(s);
+      return new Sequence_syntax(std::move(ss));
+    }
+
+    if (effective_jobs(m_jobs) > 1)
+      return parse_declaration_seq_parallel();
+
+    Syntax_seq ss;
+    while (!eof()) {
+      Trace_span span(m_trans.trace(), "declaration", "line", input_location().line);
+      m_recovering = false;
+      parse_item(*derived(), &D::parse_declaration, ss);
+    }
+    return new Sequence_syntax(std::move(ss));
+  }
+
+  /// Parses the declaration sequence in chunks of consecutive declarations,
+  /// using a copy of this parser for each worker.
+  ///
+  /// A declaration is parsed the same way wherever parsing starts at its
+  /// first token, so each chunk parses just like the corresponding part of
+  /// a serial parse, provided the previous chunk stops where it starts. When
+  /// errors make a chunk run past the end of its range, its successor is
+  /// reparsed serially from where the chunk actually stopped. Diagnostics
+  /// are collected per chunk and reported in order.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_declaration_seq_parallel()
+  {
+    std::size_t jobs = effective_jobs(m_jobs);
+    std::vector<std::size_t> starts = find_declarations();
+
+    // Use several chunks per job to balance uneven declarations.
+    std::size_t chunks = std::min(starts.size(), jobs * 8);
+
+    struct Chunk
+    {
+      std::size_t first;
+      std::size_t last;
+      std::size_t end; // Where parsing actually stopped.
+      Syntax_seq decls;
+      Diagnostic_sink diags;
+    };
+
+    std::vector<Chunk> work(chunks);
+    for (std::size_t c = 0; c < chunks; ++c) {
+      std::size_t first = starts.size() * c / chunks;
+      std::size_t last = starts.size() * (c + 1) / chunks;
+      work[c].first = starts[first];
+      work[c].last = last < starts.size() ? starts[last] : m_toks.size();
+    }
+
+    if (m_lazy)
+      body_parser();
+    std::vector<std::optional<D>> workers(jobs);
+    parallel_for(chunks, jobs, [&](std::size_t w, std::size_t c) {
+      if (!workers[w]) {
+        workers[w].emplace(*derived());
+#ifdef BEAKER_PARSER_PROFILE
+        workers[w]->m_profile = {};
+#endif
+      }
+      D& p = *workers[w];
+      Chunk& chunk = work[c];
+      Trace_span span(m_trans.trace(), "chunk", "index", c);
+      p.m_pos = chunk.first;
+      p.m_diags = &chunk.diags;
+      while (p.m_pos < chunk.last) {
+        Trace_span decl(m_trans.trace(), "declaration", "line", p.input_location().line);
+        p.m_recovering = false;
+        parse_item(p, &D::parse_declaration, chunk.decls);
+      }
+      chunk.end = p.m_pos;
+    });
+
+#ifdef BEAKER_PARSER_PROFILE
+    for (std::optional<D> const& p : workers)
+      if (p)
+        m_profile.merge(p->m_profile);
+#endif
+
+    // Stitch the chunks together.
+    Syntax_seq ss;
+    ss.reserve(starts.size());
+    m_pos = 0;
+    for (Chunk& chunk : work) {
+      if (m_pos == chunk.first) {
+        ss.insert(ss.end(), chunk.decls.begin(), chunk.decls.end());
+        for (Diagnostic const& diag : chunk.diags.diagnostics())
+          m_diags->error(diag.location, diag.message);
+        m_pos = chunk.end;
+      }
+      else {
+        Trace_span span(m_trans.trace(), "reparse chunk");
+        while (m_pos < chunk.last) {
+          Trace_span decl(m_trans.trace(), "declaration", "line", input_location().line);
+          m_recovering = false;
+          parse_item(*derived(), &D::parse_declaration, ss);
+        }
+      }
+    }
+    assert(eof());
+    return new Sequence_syntax(std::move(ss));
+  }
+
+  /// Parses top-level declarations, taking the old declaration starting at
+  /// the same token instead whenever it can be reused.
+  template<typename D>
+  Syntax* Basic_parser<D>::reparse(Syntax* old, Token_stream const& prev)
+  {
+    Syntax* decls = static_cast<File_syntax*>(old)->declarations();
+    Syntax_span olds = decls->children();
+    std::vector<std::size_t> starts = declaration_starts(decls, prev);
+    Token_diff d = diff_tokens(prev, *m_stream);
+
+    Syntax_seq ss;
+    m_pos = 0;
+    while (!eof()) {
+      std::size_t n = d.unmap(m_pos);
+      auto iter = std::lower_bound(starts.begin(), starts.end(), n);
+      if (n != d.npos && iter != starts.end() && *iter == n) {
+        std::size_t i = iter - starts.begin();
+        std::size_t last = i + 1 < starts.size() ? starts[i + 1] : prev.toks.size();
+        if (is_reusable(d, prev, *m_stream, n, last)) {
+          // Tokens in the suffix may have moved. Deferred bodies must be
+          // parsed from the new tokens.
+          Syntax* s = olds[i];
+          olds[i] = nullptr;
+          bool moved = prev.toks[n].start_location() != m_toks[m_pos].start_location();
+          if (moved || m_lazy)
+            relocate(s, d, prev, *m_stream, m_root);
+          ss.push_back(s);
+          m_pos = d.map(last);
+          continue;
+        }
+      }
+      m_recovering = false;
+      parse_item(*derived(), &D::parse_declaration, ss);
+    }
+
+    // Reused declarations were detached from the old tree, so this frees
+    // only the declarations that were reparsed.
+    destroy(old);
+    return new File_syntax(new Sequence_syntax(std::move(ss)));
+  }
+
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_declaration()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    switch (lookahead()) {
+    case Token::def_tok:
+      return parse_definition();
+    default:
+      break;
+    }
+
+    // We've got tokens not belonging to any declaration. Skip to the next
+    // one, and represent the skipped tokens by an error.
+    Token tok = peek();
+    diagnose_expected("declaration");
+    while (!eof() && next_token_is_not(Token::def_tok))
+      skip_group();
+    return new Error_syntax(tok);
+  }
+
+  /// Definition declaration:
+  ///
+  ///   definition-declaration:
+  ///     def declarator-list : type ;
+  ///     def declarator-list : initializer
+  ///     def declarator-list : type initializer
+  ///
+  ///   initializer:
+  ///     = expression ;
+  ///     { statement-list }
+  ///
+  /// TODO: Support brace initialization `def x : t { ... }`, although I'm
+  /// not sure what the grammar of `...` is. A sequence of statements? A
+  /// list of expressions. We can probably build a single grammar that supports
+  /// both.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_definition()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    Token intro = require(Token::def_tok);
+
+    // Parse the declarator
+    Syntax* decl = parse_declarator_list();
+
+    // Parse the type.
+    expect(Token::colon_tok);
+    
+    Syntax* type = nullptr;
+    if (next_token_is_not(Token::equal_tok)) {
+      type = derived()->parse_type();
+
+      // Match the 'decl : type ;' case.
+      if (match(Token::semicolon_tok))
+        return new Declaration_syntax(intro, decl, type, nullptr);
+
+      // Fall through to parse the initializer.
+    }
+
+    // Parse the initializer.
+    Syntax* init;
+    if (match(Token::equal_tok)) {
+      init = derived()->parse_expression();
+      if (!expect(Token::semicolon_tok))
+        recover();
+    }
+    else if (next_token_is(Token::lbrace_tok)) {
+      init = m_lazy ? parse_deferred_brace_list() : parse_brace_list();
+    }
+    else {
+      init = parse_error("initializer");
+      recover();
+    }
+
+    return new Declaration_syntax(intro, decl, type, init);
+  }
+
+  /// Parser a parameter:
+  ///
+  ///   parameter:
+  ///     identifier : type
+  ///     identifier : type = expression
+  ///     identifeir : = expression
+  ///     : type
+  ///     : type = expression
+  ///
+  /// TODO: Can parameters have introducers?
+  ///
+  /// TODO: Can paramters be packs (yes, but what's the syntax?).
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_parameter()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    // Match unnamed variants.
+    if (match(Token::colon_tok)) {
+      Syntax* type = derived()->parse_type();
+      Syntax* init = nullptr;
+      if (match(Token::equal_tok))
+        init = derived()->parse_expression();
+      return new Declaration_syntax({}, nullptr, type, init);
+    }
+
+    // Match the identifier...
+    Syntax* id = parse_id_expression();
+    
+    // ... And optional declarative information
+    Syntax* type = nullptr;
+    Syntax* init = nullptr;
+    if (match(Token::colon_tok)) {
+      if (next_token_is_not(Token::equal_tok))
+        type = derived()->parse_type();
+      if (match(Token::equal_tok))
+        init = derived()->parse_expression();
+    }
+
+    return new Declaration_syntax({}, id, type, init);
+  }
+
+  /// Parse a declarator-list.
+  ///   declarator-list:
+  ///     declarator
+  ///     declartor-list , declarator
+  ///
+  /// Technically, this allows the declaration of multiple functions having
+  /// the same return type, but we can semantically limit declarators to just
+  /// variables.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_declarator_list()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    Syntax_seq ts;
+    parse_item(*derived(), &D::parse_declarator, ts);
+    while (match(Token::comma_tok))
+      parse_item(*derived(), &D::parse_declarator, ts);
+    return make_declarator_list(ts);
+  }
+
+  /// Parse a declarator.
+  ///
+  ///   declarator:
+  ///     postfix-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_declarator()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return derived()->parse_postfix_expression();
+  }
+
+  /// Parse a type expression.
+  ///
+  ///   type-expression:
+  ///     prefix-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_type()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return derived()->parse_prefix_expression();
+  }
+
+  /// Parse an expression.
+  ///
+  ///   expression:
+  ///     infix-expression
+  ///     return infix-expression
+  ///     yield infix-expression
+  ///     throw infix-expression
+  ///
+  /// TODO: Actually implement throw and yield.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    switch (lookahead()) {
+    case Token::return_tok: {
+      Token tok = consume();
+      Syntax* e = parse_infix_expression();
+      return new Prefix_syntax(tok, e);
+    }
+    default:
+      break;
+    }
+    return parse_infix_expression();
+  }
+
+  /// Parse an expression.
+  ///
+  ///   infix-expression:
+  ///     assignment-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_infix_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_assignment_expression();
+  }
+
+  /// Parse an assignment.
+  ///
+  ///   assignment-expression:
+  ///     implication-expression
+  ///     implication-expression = assignment-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_assignment_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(assignment_precedence);
+  }
+
+  /// Parse an implication.
+  ///
+  ///   implication-expression:
+  ///     logical-or-expression
+  ///     logical-or-expression -> implication-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_implication_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(implication_precedence);
+  }
+
+  /// Parse an logical or.
+  ///
+  ///   logical-or-expression:
+  ///     logical-and-expression
+  ///     logical-or-expression or logical-and-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_logical_or_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(logical_or_precedence);
+  }
+
+  /// Parse an logical and.
+  ///
+  ///   logical-and-expression:
+  ///     equality-expression
+  ///     logical-and-expression and equality-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_logical_and_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(logical_and_precedence);
+  }
+
+  /// Parse an equality comparison.
+  ///
+  ///   equality-expression:
+  ///     relational-expression
+  ///     equality-expression == relational-expression
+  ///     equality-expression != relational-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_equality_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(equality_precedence);
+  }
+
+  /// Parse a relational expression.
+  ///
+  ///   relational-expression:
+  ///     additive-expression
+  ///     relational-expression < additive-expression
+  ///     relational-expression > additive-expression
+  ///     relational-expression <= additive-expression
+  ///     relational-expression >= additive-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_relational_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(relational_precedence);
+  }
+
+  /// Parse an additive expression.
+  ///
+  ///   additive-expression:
+  ///     multiplicative-expression
+  ///     additive-expression + multiplicative-expression
+  ///     additive-expression - multiplicative-expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_additive_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(additive_precedence);
+  }
+
+  /// Parse a multiplicative expression.
+  ///
+  ///   multiplicative-expression:
+  ///     prefix-exprssion
+  ///     multiplicative-expression * prefix-exprssion
+  ///     multiplicative-expression / prefix-exprssion
+  ///     multiplicative-expression % prefix-exprssion
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_multiplicative_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_binary_expression(multiplicative_precedence);
+  }
+
+  /// Parse a sequence of prefix-expressions separated by infix operators
+  /// that bind at least as tightly as `min`.
+  ///
+  /// This is an operator-precedence (Pratt) parser. The binding of each
+  /// operator is looked up in `m_infix`, so a bare operand takes a single
+  /// call, regardless of the number of precedence levels. It builds the
+  /// same trees as the recursive-descent grammar above.
+  ///
+  /// Operators whose right operands are still being parsed are kept on an
+  /// explicit stack rather than in recursive calls, so long chains of
+  /// right-associative operators don't exhaust the call stack.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_binary_expression(Precedence min)
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    // An operator and its left operand, and the minimum precedence of
+    // operators in its right operand.
+    struct Pending
+    {
+      Token op;
+      Syntax* lhs;
+      Precedence min;
+    };
+    std::vector<Pending> stack;
+
+    Syntax* e0 = derived()->parse_prefix_expression();
+    while (true) {
+      Infix_operator op = m_infix[lookahead()];
+      Precedence lo = stack.empty() ? min : stack.back().min;
+      if (op.precedence == no_precedence || op.precedence < lo) {
+        // The operand completes the right operand of the pending operator.
+        if (stack.empty())
+          break;
+        Pending p = stack.back();
+        stack.pop_back();
+        e0 = new Infix_syntax(p.op, p.lhs, e0);
+        continue;
+      }
+      Token tok = consume();
+
+      // The right operand of a left-associative operator only includes
+      // tighter-binding operators.
+      Precedence next = op.precedence;
+      if (op.associativity == Associativity::left)
+        next = Precedence(next + 1);
+      stack.push_back({tok, e0, next});
+      e0 = derived()->parse_prefix_expression();
+    }
+    return e0;
+  }
+
+  /// Parse a prefix-expression.
+  ///
+  ///   prefix-expression:
+  ///     postfix-expression
+  ///     array [ expression-list? ] prefix-expression
+  ///     templ [ expression-group? ] prefix-expression
+  ///     func ( expression-group? ) prefix-expression
+  ///     const prefix-exprssion
+  ///     ^ prefix-expression
+  ///     - prefix-expression
+  ///     + prefix-expression
+  ///     not prefix-expression
+  ///
+  /// NOTE: This is the minimal version of a grammar that both avoids extra
+  /// lookahead and permits expressions and types to occupy the same grammar.
+  /// We could add extra annotations after template and function type
+  /// constructors (e.g., `func(int)->int`), but they aren't strictly necessary.
+  ///
+  /// TODO: The name array is somewhat unfortunate, since it makes a nice
+  /// library structure. If arrays in this (or whatever) language had regular
+  /// semantics, we probably wouldn't need the data type.
+  ///
+  /// Eliminating the leading keyword and adding an annotation before the prefix
+  /// expression also works (e.g., (int)->int), but requires lookahead to
+  /// disambiguate the enclosure from primary expressions. It also means that
+  /// we can't parse implications, unless we had some way of explicitly
+  /// characterizing the leading parameter list as something other than a
+  /// primary expression.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_prefix_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    switch (lookahead())
+    {
+    case Token::array_tok: {
+      Token tok = consume();
+      Syntax* bound = parse_bracket_list();
+      Syntax* type = nested([this] { return derived()->parse_prefix_expression(); });
+      return new Array_syntax(tok, bound, type);
+    }
+
+    case Token::templ_tok: {
+      Token tok = consume();
+      Syntax* parms = parse_bracket_group();
+      Syntax* result = nested([this] { return derived()->parse_prefix_expression(); });
+      return new Template_syntax(tok, parms, result);
+    }
+
+    case Token::func_tok: {
+      Token tok = consume();
+      Syntax* parms = parse_paren_group();
+      Syntax* result = nested([this] { return derived()->parse_prefix_expression(); });
+      return new Function_syntax(tok, parms, result);
+    }
+
+    case Token::const_tok:
+    case Token::caret_tok:
+    case Token::plus_tok:
+    case Token::dash_tok:
+    case Token::not_tok: {
+      Token op = consume();
+      Syntax* e = nested([this] { return derived()->parse_prefix_expression(); });
+      return new Prefix_syntax(op, e);
+    }
+    
+    default:
+      break;
+    }
+    return derived()->parse_postfix_expression();
+  }
+
+  /// Parse a postfix-expression.
+  ///
+  ///   postfix-expression:
+  ///     primary-expression
+  ///     postfix-expression ( expression-list? )
+  ///     postfix-expression [ expression-list? ]
+  ///     postfix-expression . id-expression
+  ///     postfix-expression ^
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_postfix_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    Syntax* e0 = derived()->parse_primary_expression();
+    while (true)
+    {
+      if (next_token_is(Token::lparen_tok)) {
+        Syntax* args = parse_paren_list();
+        e0 = new Call_syntax(e0, args);
+      }
+      else if (next_token_is(Token::lbracket_tok)) {
+        Syntax* args = parse_bracket_list();
+        e0 = new Call_syntax(e0, args);
+      }
+      else if (Token dot = match(Token::dot_tok)) {
+        Syntax* member = parse_id_expression();
+        e0 = new Infix_syntax(dot, e0, member);
+      }
+      else if (Token op = match(Token::caret_tok)) {
+        e0 = new Postfix_syntax(op, e0);
+      }        
+      else
+        break;
+    }
+    return e0;
+  }
+
+  /// Parse a primary expression.
+  ///
+  ///   primary-expression:
+  ///     literal
+  ///     id-expression
+  ///     ( expression-list? )
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_primary_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    switch (lookahead()) {
+      // Value literals
+    case Token::true_tok:
+    case Token::false_tok:
+    case Token::integer_tok:
+    // Type literals
+    case Token::int_tok:
+    case Token::bool_tok:
+    case Token::type_tok: {
+      Token value = consume();
+      return new Literal_syntax(value);
+    }
+
+    case Token::identifier_tok:
+      return parse_id_expression();
+
+    case Token::lparen_tok:
+      // Memoized for grammars that try another production starting with `(`
+      // first, and then backtrack.
+      if (memoizing())
+        return speculate(Production::paren_list, [this] {
+          return parse_paren_list();
+        });
+      return parse_paren_list();
+    
+    case Token::lbrace_tok:
+      return parse_brace_list();
+
+    default:
+      break;
+    }
+
+    return parse_error("primary-expression");
+  }
+
+  /// Parse an id-expression
+  ///
+  ///   id-expression:
+  ///     identifier
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_id_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    if (Token id = match(Token::identifier_tok))
+      return new Identifier_syntax(id);
+    return parse_error("identifier");
+  }
+
+  /// Parse a paren-enclosed group.
+  ///
+  ///   paren-group:
+  ///     ( expression-group? )
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_paren_group()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_enclosed<Enclosure::parens>(&Basic_parser::parse_expression_group);
+  }
+
+  /// Parse a paren-enclosed list.
+  ///
+  ///   paren-list:
+  ///     ( expression-list? )
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_paren_list()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_enclosed<Enclosure::parens>(&Basic_parser::parse_expression_list);
+  }
+
+  /// Parse a bracket-enclosed group.
+  ///
+  ///   bracket-group:
+  ///     [ expression-group? ]
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_bracket_group()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_enclosed<Enclosure::brackets>(&Basic_parser::parse_expression_group);
+  }
+
+  /// Parse a bracket-enclosed list.
+  ///
+  ///   bracket-list:
+  ///     [ expression-list? ]
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_bracket_list()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_enclosed<Enclosure::brackets>(&Basic_parser::parse_expression_list);
+  }
+
+  /// Parse an expression-group.
+  ///
+  ///   expression-group:
+  ///     expression-list
+  ///     expression-group ; expression-list
+  ///
+  /// Groups are only created if multiple groups are present.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_expression_group()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    Syntax_seq ts;
+    parse_item(*this, &Basic_parser::parse_expression_list, ts);
+    while (match(Token::semicolon_tok))
+      parse_item(*this, &Basic_parser::parse_expression_list, ts);
+    return make_group(ts);
+  }
+
+  /// Parse an expression-list.
+  ///
+  ///   expression-list:
+  ///     parameter-expression
+  ///     expression-list , parameter-expression
+  ///
+  /// This always returns a list, even if there's a single element.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_expression_list()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    Syntax_seq ts;
+    parse_item(*this, &Basic_parser::parse_parameter_or_expression, ts);
+    while (match(Token::comma_tok))
+      parse_item(*this, &Basic_parser::parse_parameter_or_expression, ts);
+    return make_list(ts);
+  }
+
+  /// Parse a parameter or expression.
+  ///
+  ///   parameter-expression:
+  ///     parameter
+  ///     expression
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_parameter_or_expression()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    if (starts_parameter(*this))
+      return parse_parameter();
+    return derived()->parse_expression();
+  }
+
+  /// Parse a brace-enclosed list.
+  ///
+  ///   brace-list:
+  ///     { statement-seq }
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_brace_list()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_enclosed<Enclosure::braces>(&Basic_parser::parse_statement_seq);
+  }
+
+  /// Skips a brace-list, returning a deferred node. If the brace has no
+  /// matching brace, the list is parsed now.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_deferred_brace_list()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    std::size_t n = m_matches[m_pos];
+    if (n == m_toks.size())
+      return parse_brace_list();
+    Token open = m_toks[m_pos];
+    Token close = m_toks[n];
+    Syntax* s = new Deferred_syntax(open, close, body_parser(), m_pos);
+    m_pos = n + 1;
+    return s;
+  }
+
+  template<typename D>
+  std::shared_ptr<Parser> Basic_parser<D>::copy() const
+  {
+    return std::make_shared<D>(*static_cast<D const*>(this));
+  }
+
+  /// Parses the deferred brace-list at `pos` like `parse_brace_list`, and
+  /// returns its inner term. The state of the parser is preserved.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_deferred(std::size_t pos)
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    std::size_t save_pos = m_pos;
+    bool save_recovering = m_recovering;
+    m_pos = pos;
+    m_recovering = false;
+    require(Token::lbrace_tok);
+    Syntax* t = nullptr;
+    if (next_token_is_not(Token::rbrace_tok))
+      t = parse_statement_seq();
+    expect(Token::rbrace_tok);
+    m_pos = save_pos;
+    m_recovering = save_recovering;
+    return t;
+  }
+
+  /// Parse a statement sequence.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_statement_seq()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    // Parse a statement and increment the count. This is used to allow
+    // the omission of the a trailing semicolon on first statements.
+    std::size_t num = 0;
+    auto parse = [this, &num]() {
+      return derived()->parse_statement(num++);
+    };
+
+    Syntax_seq ts;
+    parse_item(parse, ts);
+    while (next_token_is_not(Token::rbrace_tok) && !eof())
+      parse_item(parse, ts);
+
+    return make_declarator_list(ts);
+  }
+
+  /// Parse a statement.
+  ///
+  ///   statement:
+  ///     declaration-statement
+  ///     return-statement
+  ///     expression-statement
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_statement(std::size_t n)
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    m_recovering = false;
+    switch (lookahead()) {
+    case Token::def_tok:
+      return parse_declaration_statement(n);
+    default:
+      break;
+    }
+    return parse_expression_statement(n);
+  }
+
+  /// Parse a declaration-statement.
+  ///
+  ///   declaration-statement:
+  ///     declaration
+  ///
+  /// Not all declarations are allowed in all scopes. However, we don't
+  /// really have a notion of scope attached to the parse, so we have to
+  /// filter semantically.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_declaration_statement(std::size_t n)
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    return derived()->parse_declaration();
+  }
+
+  /// Parse an expression-statement.
+  ///
+  ///   expression-statement:
+  ///     expression-list ;?
+  ///
+  /// The semicolon is required this is the first statement in a brace-list
+  /// and the next token is `}`. That allows for brace-lists of the form
+  /// `{ a, b, c }`.
+  template<typename D>
+  Syntax* Basic_parser<D>::parse_expression_statement(std::size_t n)
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    Syntax* e = parse_expression_list();
+    if (n == 0 && next_token_is(Token::rbrace_tok))
+      return e;
+    if (!expect(Token::semicolon_tok))
+      recover();
+    return e;
+  }
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,34 @@
+#include <beaker/frontend/batch.hpp>
+
+#include <beaker/language/parallel.hpp>
+
+namespace beaker
+{
+  Batch_parser::Batch_parser(Factory make, std::size_t jobs)
+    : m_make(std::move(make)), m_jobs(effective_jobs(jobs)), m_syms(std::make_shared<Symbol_table>())
+  { }
+
+  std::vector<Batch_result> Batch_parser::parse(std::span<Batch_source const> sources)
+  {
+    std::size_t jobs = std::min(m_jobs, sources.size());
+    while (m_workers.size() < jobs) {
+      Worker w;
+      w.trans = std::make_unique<Translation>(m_syms);
+      w.parser = m_make(*w.trans);
+      w.parser->set_lazy(false);
+      m_workers.push_back(std::move(w));
+    }
+
+    std::vector<Batch_result> results(sources.size());
+    parallel_for(sources.size(), jobs, [&](std::size_t w, std::size_t i) {
+      Parser& p = *m_workers[w].parser;
+      Diagnostic_sink& diags = m_workers[w].trans->diagnostics();
+      p.reset(sources[i].path, sources[i].text);
+      results[i].tree = p.parse_file();
+      results[i].diags = std::move(diags.m_diags);
+      diags.m_diags.clear();
+    });
+    return results;
+  }
+
+} // namespace beaker
@@ -0,0 +1,69 @@
+#ifndef BEAKER_FRONTEND_BATCH_HPP
+#define BEAKER_FRONTEND_BATCH_HPP
+
+#include <beaker/language/translation.hpp>
+#include <beaker/frontend/parser.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace beaker
+{
+  /// A source to parse in a batch: the text of the file `path`.
+  struct Batch_source
+  {
+    std::filesystem::path path;
+    std::string text;
+  };
+
+  /// The tree and diagnostics of a source parsed in a batch.
+  struct Batch_result
+  {
+    Syntax* tree;
+    std::vector<Diagnostic> diags;
+  };
+
+  /// Parses many small sources, keeping a warm parser for each worker
+  /// thread. Parsers are `reset` between sources, so their lexers, keyword
+  /// tables, and token storage are reused.
+  ///
+  /// Each worker has its own translation, so diagnostics are kept apart, but
+  /// workers share one symbol table, so equal names in trees parsed by
+  /// different workers are the same symbol. Trees are valid for the lifetime
+  /// of the batch parser.
+  /// Definition bodies are never deferred, since a parser's tokens are
+  /// replaced by the next source.
+  struct Batch_parser
+  {
+    /// Creates a parser using a translation, e.g.:
+    ///
+    ///   [](Translation& t) { return std::make_unique<First_parser>(t, "", ""); }
+    using Factory = std::function<std::unique_ptr<Parser>(Translation&)>;
+
+    /// Parses with `jobs` workers. Zero uses one worker per hardware thread.
+    Batch_parser(Factory make, std::size_t jobs = 0);
+
+    /// Parses each of `sources`, returning their results in order.
+    std::vector<Batch_result> parse(std::span<Batch_source const> sources);
+
+    struct Worker
+    {
+      std::unique_ptr<Translation> trans;
+      std::unique_ptr<Parser> parser;
+    };
+
+    Factory m_make;
+    std::size_t m_jobs;
+    std::shared_ptr<Symbol_table> m_syms;
+
+    // Workers are created as needed, and kept for later batches.
+    std::vector<Worker> m_workers;
+  };
+
+} // namespace beaker
+
+#endif
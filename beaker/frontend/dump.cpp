@@ -0,0 +1,358 @@
+#include <beaker/frontend/dump.hpp>
+#include <beaker/frontend/location_pass.hpp>
+
+#include <beaker/language/output_buffer.hpp>
+
+namespace beaker
+{
+  bool parse_dump_format(std::string_view name, Dump_format& f)
+  {
+    if (name == "text")
+      f = Dump_format::text;
+    else if (name == "json")
+      f = Dump_format::json;
+    else if (name == "sexpr")
+      f = Dump_format::sexpr;
+    else
+      return false;
+    return true;
+  }
+
+  namespace
+  {
+    // Writes `loc` in the format `line:column`. The column is omitted if it
+    // is unknown. This matches `operator<<` for locations.
+    void write_location(Output_buffer& out, Source_location loc)
+    {
+      out.write_number(loc.line);
+      if (loc.column != 0) {
+        out.put(':');
+        out.write_number(loc.column);
+      }
+    }
+
+    // Writes `range`. This matches `operator<<` for ranges.
+    void write_range(Output_buffer& out, Source_range range)
+    {
+      if (range.is_invalid()) {
+        out.write("<invalid>");
+        return;
+      }
+
+      if (range.is_span()) {
+        out.write_number(range.start.line);
+        out.put(':');
+        out.write_number(range.start.column);
+        if (!range.is_location()) {
+          out.put('-');
+          out.write_number(range.end.column);
+        }
+      }
+      else {
+        write_location(out, range.start);
+        out.write("..");
+        write_location(out, range.end);
+      }
+    }
+
+    // Writes `str` as the contents of a JSON or S-expression string.
+    void write_escaped(Output_buffer& out, std::string_view str)
+    {
+      static char const hex[] = "0123456789abcdef";
+      for (char c : str) {
+        if (c == '"' || c == '\\') {
+          out.put('\\');
+          out.put(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+          out.write("\\u00");
+          out.put(hex[(c >> 4) & 0xf]);
+          out.put(hex[c & 0xf]);
+        }
+        else {
+          out.put(c);
+        }
+      }
+    }
+
+    // Print attributes for a node. E is the emitter for the output format.
+    template<typename E>
+    struct Dump_attrs_visitor : Const_syntax_visitor<Dump_attrs_visitor<E>, void>
+    {
+      Dump_attrs_visitor(E& e)
+        : e(e)
+      { }
+
+      void visit_Literal(Literal_syntax const* s)
+      {
+        e.attribute("value", s->spelling());
+      }
+
+      void visit_Identifier(Identifier_syntax const* s)
+      {
+        e.attribute("identifier", s->spelling());
+      }
+
+      void visit_Error(Error_syntax const* s)
+      {
+        e.attribute("token", s->spelling());
+      }
+
+      void visit_Prefix(Prefix_syntax const* s)
+      {
+        e.attribute("operator", s->operation().spelling());
+      }
+
+      void visit_Postfix(Postfix_syntax const* s)
+      {
+        e.attribute("operator", s->operation().spelling());
+      }
+
+      void visit_Infix(Infix_syntax const* s)
+      {
+        e.attribute("operator", s->operation().spelling());
+      }
+
+      void visit_Constructor(Constructor_syntax const* s)
+      {
+        e.attribute("type", s->type().spelling());
+      }
+
+      void visit_Introduction(Introduction_syntax const* s)
+      {
+        // Don't fall through to Constructors.
+      }
+
+      void visit_Enclosure(Enclosure_syntax const* s)
+      {
+        e.attribute("brackets", s->open().spelling(), s->close().spelling());
+      }
+
+      E& e;
+    };
+
+    // Writes each node using the emitter `e`. `range` points to the range
+    // of the next node to be written.
+    template<typename E>
+    struct Dump_pass : Const_syntax_pass<Dump_pass<E>>
+    {
+      Dump_pass(E& e, Source_range const* ranges)
+        : e(e), range(ranges)
+      { }
+
+      void visit_Syntax(Syntax const* s)
+      {
+        e.start_node(s, *range++, depth);
+        Dump_attrs_visitor<E> attrs(e);
+        attrs.visit(s);
+        e.start_children(s, depth);
+        ++depth;
+      }
+
+      void visit_null(std::size_t n)
+      {
+        e.null_node(n, depth);
+      }
+
+      void leave_Syntax(Syntax const* s)
+      {
+        --depth;
+        e.end_node(s, depth);
+      }
+
+      E& e;
+      Source_range const* range;
+      std::size_t depth = 0;
+    };
+
+    // Writes `s` and its subtrees using the emitter `e`.
+    template<typename E>
+    void dump_tree(E& e, Syntax const* s, Source_range const* ranges)
+    {
+      Dump_pass<E> pass(e, ranges);
+      traverse(s, pass);
+    }
+
+    // The indented, line-oriented format. Omitted subtrees are not printed.
+    struct Text_emitter
+    {
+      void start_node(Syntax const* s, Source_range range, std::size_t depth)
+      {
+        out.put(' ', depth * 2);
+        out.write(s->kind_name());
+        out.write(" @");
+        write_range(out, range);
+      }
+
+      void attribute(char const* name, std::string_view v1, std::string_view v2 = {})
+      {
+        out.put(' ');
+        out.write(name);
+        out.write("='");
+        out.write(v1);
+        out.write(v2);
+        out.put('\'');
+      }
+
+      void start_children(Syntax const* s, std::size_t depth)
+      {
+        out.put('\n');
+      }
+
+      void null_node(std::size_t n, std::size_t depth)
+      { }
+
+      void end_node(Syntax const* s, std::size_t depth)
+      { }
+
+      Output_buffer& out;
+    };
+
+    // Each node is an object with its kind, range, attributes, and children.
+    // Omitted subtrees are `null`, so children are positional.
+    struct Json_emitter
+    {
+      void separate(std::size_t n)
+      {
+        if (n != 0)
+          out.put(',');
+      }
+
+      void location(char const* name, Source_location loc)
+      {
+        out.write(name);
+        out.put('[');
+        out.write_number(loc.line);
+        out.put(',');
+        out.write_number(loc.column);
+        out.put(']');
+      }
+
+      void start_node(Syntax const* s, Source_range range, std::size_t depth)
+      {
+        separate(m_index);
+        out.write("{\"kind\":\"");
+        out.write(s->kind_name());
+        out.put('"');
+        if (range.is_valid()) {
+          location(",\"start\":", range.start);
+          location(",\"end\":", range.end);
+        }
+      }
+
+      void attribute(char const* name, std::string_view v1, std::string_view v2 = {})
+      {
+        out.write(",\"");
+        out.write(name);
+        out.write("\":\"");
+        write_escaped(out, v1);
+        write_escaped(out, v2);
+        out.put('"');
+      }
+
+      void start_children(Syntax const* s, std::size_t depth)
+      {
+        out.write(",\"children\":[");
+        m_index = 0;
+      }
+
+      void null_node(std::size_t n, std::size_t depth)
+      {
+        separate(n);
+        out.write("null");
+        m_index = n + 1;
+      }
+
+      void end_node(Syntax const* s, std::size_t depth)
+      {
+        out.write("]}");
+        m_index = 1;
+        if (depth == 0)
+          out.put('\n');
+      }
+
+      Output_buffer& out;
+
+      // The position of the next node in its parent's children.
+      std::size_t m_index = 0;
+    };
+
+    // Each node is a list of its kind, range, keyword attributes, and
+    // children. Omitted subtrees are `nil`.
+    struct Sexpr_emitter
+    {
+      void start_node(Syntax const* s, Source_range range, std::size_t depth)
+      {
+        if (depth != 0) {
+          out.put('\n');
+          out.put(' ', depth * 2);
+        }
+        out.put('(');
+        out.write(s->kind_name());
+        out.write(" :location \"");
+        write_range(out, range);
+        out.put('"');
+      }
+
+      void attribute(char const* name, std::string_view v1, std::string_view v2 = {})
+      {
+        out.write(" :");
+        out.write(name);
+        out.write(" \"");
+        write_escaped(out, v1);
+        write_escaped(out, v2);
+        out.put('"');
+      }
+
+      void start_children(Syntax const* s, std::size_t depth)
+      { }
+
+      void null_node(std::size_t n, std::size_t depth)
+      {
+        out.put('\n');
+        out.put(' ', depth * 2);
+        out.write("nil");
+      }
+
+      void end_node(Syntax const* s, std::size_t depth)
+      {
+        out.put(')');
+        if (depth == 0)
+          out.put('\n');
+      }
+
+      Output_buffer& out;
+    };
+  } // namespace
+
+  void dump(Syntax const* s, std::ostream& os, Dump_format f)
+  {
+    // Compute all ranges up front. Computing each range separately would
+    // revisit the subtrees of every node.
+    std::vector<Source_range> ranges = locations(s);
+    dump(s, ranges.data(), os, f);
+  }
+
+  void dump(Syntax const* s, Source_range const* ranges, std::ostream& os, Dump_format f)
+  {
+    Output_buffer out(os);
+    switch (f) {
+    case Dump_format::text: {
+      Text_emitter e{out};
+      dump_tree(e, s, ranges);
+      break;
+    }
+    case Dump_format::json: {
+      Json_emitter e{out};
+      dump_tree(e, s, ranges);
+      break;
+    }
+    case Dump_format::sexpr: {
+      Sexpr_emitter e{out};
+      dump_tree(e, s, ranges);
+      break;
+    }
+    }
+  }
+
+} // namespace beaker
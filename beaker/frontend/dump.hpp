@@ -0,0 +1,33 @@
+#ifndef BEAKER_FRONTEND_DUMP_HPP
+#define BEAKER_FRONTEND_DUMP_HPP
+
+#include <beaker/frontend/syntax.hpp>
+
+#include <iosfwd>
+#include <string_view>
+
+namespace beaker
+{
+  /// The output formats for syntax trees.
+  enum class Dump_format
+  {
+    text,  // Indented, one node per line.
+    json,  // A JSON object per node.
+    sexpr, // An S-expression per node.
+  };
+
+  /// Sets `f` to the format named by `name`. Returns false if there is no
+  /// such format.
+  bool parse_dump_format(std::string_view name, Dump_format& f);
+
+  /// Writes the tree `s` to `os` in the format `f`. Output is written in
+  /// large blocks, so `os` does not need to be buffered.
+  void dump(Syntax const* s, std::ostream& os, Dump_format f = Dump_format::text);
+
+  /// Writes the tree `s` to `os` in the format `f`, given the ranges of `s`
+  /// and its non-null subtrees in pre-order (see `locations`).
+  void dump(Syntax const* s, Source_range const* ranges, std::ostream& os, Dump_format f = Dump_format::text);
+
+} // namespace beaker
+
+#endif
@@ -7,5 +7,6 @@
 
 namespace beaker
 {
+  template struct Basic_parser<First_parser>;
 
 } // namespace beaker
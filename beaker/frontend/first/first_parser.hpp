@@ -1,7 +1,7 @@
 #ifndef BEAKER_FRONTEND_FIRST_PARSER_HPP
 #define BEAKER_FRONTEND_FIRST_PARSER_HPP
 
-#include <beaker/frontend/parser.hpp>
+#include <beaker/frontend/basic_parser.hpp>
 
 namespace beaker
 {
@@ -9,11 +9,13 @@ namespace beaker
   ///
   /// This language simply inherits the grammar of the "root" parser. It
   /// doesn't change any of the syntax.
-  struct First_parser : Parser
+  struct First_parser : Basic_parser<First_parser>
   {
-    using Parser::Parser;
+    using Basic_parser::Basic_parser;
   };
 
+  extern template struct Basic_parser<First_parser>;
+
 } // namespace beaker
 
 #endif
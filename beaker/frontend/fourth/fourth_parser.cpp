@@ -7,39 +7,50 @@
 
 namespace beaker
 {
-  /// Parse a type expression.
+  /// The infix grammar of this language is:
   ///
-  ///   type-expression:
+  ///   infix-expression:
+  ///     assignment-expression
+  ///
+  ///   assignment-expression:
   ///     implication-expression
-  Syntax* Fourth_parser::parse_type()
+  ///     implication-expression = assignment-expression
+  ///
+  ///   implication-expression:
+  ///     prefix-expression
+  ///     prefix-expression -> implication-expression
+  ///     prefix-expression => implication-expression
+  ///
+  /// We currently keep `->` and `=>` at the same precedence even though types
+  /// like `(int) -> [t:type] => t` are somewhat peculiar. This is a (probably
+  /// compile-time) function returning some unary variable template.
+  Fourth_parser::Fourth_parser(Translation& trans, std::filesystem::path const& p)
+    : Fourth_parser(trans, p, read_file(p))
+  { }
+
+  Fourth_parser::Fourth_parser(Translation& trans, std::filesystem::path const& p, std::string text)
+    : Basic_parser(trans, p, std::move(text))
   {
-    return parse_implication_expression();
+    m_infix.clear();
+    m_infix.set(Token::equal_tok, assignment_precedence, Associativity::right);
+    m_infix.set(Token::dash_greater_tok, implication_precedence, Associativity::right);
+    m_infix.set(Token::equal_greater_tok, implication_precedence, Associativity::right);
   }
 
-  static bool is_implication_operator(Token::Kind k)
+  Fourth_parser::Fourth_parser(Translation& trans, std::filesystem::path const& p, std::istream& is)
+    : Fourth_parser(trans, p, std::string())
   {
-    return k == Token::dash_greater_tok ||
-           k == Token::equal_greater_tok;
+    set_input(p, is);
   }
 
-  /// Parse an implication.
-  ///
-  ///   implication-expression:
-  ///     logical-or-expression
-  ///     logical-or-expression -> implication-expression
-  ///     logical-or-expression => implication-expression
+  /// Parse a type expression.
   ///
-  /// We currently keep `->` and `=>` at the same precedence even though types
-  /// like `(int) -> [t:type] => t` are somewhat peculiar. This is a (probably
-  /// compile-time) function returning some unary variable template.
-  Syntax* Fourth_parser::parse_implication_expression()
+  ///   type-expression:
+  ///     implication-expression
+  Syntax* Fourth_parser::parse_type()
   {
-    Syntax* e0 = parse_prefix_expression();
-    if (Token op = match_if(is_implication_operator)) {
-      Syntax* e1 = parse_implication_expression();
-      return new Infix_syntax(op, e0, e1);
-    }
-    return e0;
+    BEAKER_PROFILE_PRODUCTION();
+    return parse_implication_expression();
   }
 
   /// Parse a prefix-expression.
@@ -54,6 +65,7 @@ namespace beaker
   ///     not prefix-expression
   Syntax* Fourth_parser::parse_prefix_expression()
   {
+    BEAKER_PROFILE_PRODUCTION();
     switch (lookahead())
     {
     case Token::const_tok:
@@ -63,7 +75,7 @@ namespace beaker
     case Token::dash_tok:
     case Token::not_tok: {
       Token op = consume();
-      Syntax* e = parse_prefix_expression();
+      Syntax* e = nested([this] { return parse_prefix_expression(); });
       return new Prefix_syntax(op, e);
     }
     
@@ -82,6 +94,7 @@ namespace beaker
   ///     postfix-expression . id-expression
   Syntax* Fourth_parser::parse_postfix_expression()
   {
+    BEAKER_PROFILE_PRODUCTION();
     Syntax* e0 = parse_primary_expression();
     while (true)
     {
@@ -112,6 +125,7 @@ namespace beaker
   ///     id-expression
   Syntax* Fourth_parser::parse_primary_expression()
   {
+    BEAKER_PROFILE_PRODUCTION();
     switch (lookahead()) {
       // Value literals
     case Token::true_tok:
@@ -143,12 +157,9 @@ namespace beaker
       break;
     }
 
-    // FIXME: Return an error tree. Also, how can we recover from this?
-    // It might depend on what we're parsing (declarator, type, initialzer,
-    // etc.). To do that, we'd have to maintain a stack of recovery strategies
-    // that we can use to skip tokens.
-    diagnose_expected("primary-expression");
-    return nullptr;
+    return parse_error("primary-expression");
   }
 
+  template struct Basic_parser<Fourth_parser>;
+
 } // namespace beaker
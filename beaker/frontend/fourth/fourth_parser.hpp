@@ -1,22 +1,25 @@
 #ifndef BEAKER_FRONTEND_FOURTH_PARSER_HPP
 #define BEAKER_FRONTEND_FOURTH_PARSER_HPP
 
-#include <beaker/frontend/parser.hpp>
+#include <beaker/frontend/basic_parser.hpp>
 
 namespace beaker
 {
   /// Constructs a concrete syntax tree from a source file.
-  struct Fourth_parser : Parser
+  struct Fourth_parser : Basic_parser<Fourth_parser>
   {
-    using Parser::Parser;
+    Fourth_parser(Translation& trans, std::filesystem::path const& p);
+    Fourth_parser(Translation& trans, std::filesystem::path const& p, std::string text);
+    Fourth_parser(Translation& trans, std::filesystem::path const& p, std::istream& is);
 
-    Syntax* parse_type() override;
-    Syntax* parse_implication_expression() override;
-    Syntax* parse_prefix_expression() override;
-    Syntax* parse_postfix_expression() override;
-    Syntax* parse_primary_expression() override;
+    Syntax* parse_type();
+    Syntax* parse_prefix_expression();
+    Syntax* parse_postfix_expression();
+    Syntax* parse_primary_expression();
   };
 
+  extern template struct Basic_parser<Fourth_parser>;
+
 } // namespace beaker
 
 #endif
@@ -0,0 +1,182 @@
+#include <beaker/frontend/incremental.hpp>
+#include <beaker/frontend/parser.hpp>
+
+#include <algorithm>
+
+namespace beaker
+{
+  // Returns true if `a` and `b` are the same token, ignoring location.
+  static bool same_token(Token a, Token b)
+  {
+    return a.kind() == b.kind() && a.symbol() == b.symbol();
+  }
+
+  Token_diff diff_tokens(Token_stream const& a, Token_stream const& b)
+  {
+    Token_diff d;
+    d.old_size = a.toks.size();
+    d.new_size = b.toks.size();
+
+    // Tokens in the prefix must not have moved either. An edit that only
+    // changes whitespace moves tokens without changing them.
+    std::size_t n = std::min(d.old_size, d.new_size);
+    d.prefix = 0;
+    while (d.prefix < n &&
+           same_token(a.toks[d.prefix], b.toks[d.prefix]) &&
+           a.toks[d.prefix].start_location() == b.toks[d.prefix].start_location())
+      ++d.prefix;
+
+    d.suffix = 0;
+    while (d.suffix < n - d.prefix &&
+           same_token(a.toks[d.old_size - d.suffix - 1], b.toks[d.new_size - d.suffix - 1]))
+      ++d.suffix;
+
+    return d;
+  }
+
+  // Returns the position of the token in `toks` at `loc`. Locations not
+  // belonging to any token (i.e., that of the end of file) map to the end
+  // of the stream.
+  static std::size_t find_token(Token_stream const& toks, Source_location loc)
+  {
+    auto iter = std::lower_bound(toks.toks.begin(), toks.toks.end(), loc, [](Token tok, Source_location loc) {
+      return tok.start_location() < loc;
+    });
+    if (iter != toks.toks.end() && iter->start_location() == loc)
+      return iter - toks.toks.begin();
+    return toks.toks.size();
+  }
+
+  std::vector<std::size_t> declaration_starts(Syntax const* decls, Token_stream const& toks)
+  {
+    std::vector<std::size_t> starts;
+    starts.reserve(decls->children().size());
+    for (Syntax const* s : decls->children())
+      starts.push_back(find_token(toks, s->location().start));
+    return starts;
+  }
+
+  bool is_reusable(Token_diff const& d,
+                   Token_stream const& a,
+                   Token_stream const& b,
+                   std::size_t first,
+                   std::size_t last)
+  {
+    // The declaration and the two tokens that follow it must be unchanged.
+    // Recovery and some lookahead rules look past the end of a declaration,
+    // possibly by skipping to the match of a bracket within it.
+    std::size_t reach = last;
+    for (std::size_t i = first; i < last; ++i) {
+      std::size_t m = a.matches[i];
+      if (m != a.toks.size() && m >= reach)
+        reach = m + 1;
+    }
+    bool in_prefix = reach + 1 < d.prefix;
+    bool in_suffix = first >= d.old_size - d.suffix;
+    if (!in_prefix && !in_suffix)
+      return false;
+
+    // Brackets must match the same tokens. Unmatched brackets match the
+    // end of file.
+    for (std::size_t i = first; i < last; ++i) {
+      std::size_t m = a.matches[i];
+      std::size_t n = b.matches[d.map(i)];
+      if (m == a.toks.size() ? n != b.toks.size() : d.map(m) != n)
+        return false;
+    }
+    return true;
+  }
+
+  namespace
+  {
+    struct Relocator : Syntax_visitor<Relocator, void>
+    {
+      // Returns `tok` located at its position in the new stream.
+      Token move(Token tok)
+      {
+        Source_location loc = tok.start_location();
+        if (loc.is_invalid())
+          return tok;
+        std::size_t n = find_token(a, loc);
+        if (n == a.toks.size())
+          loc = b.eof.start_location();
+        else
+          loc = b.toks[d.map(n)].start_location();
+        return Token(tok.kind(), tok.symbol(), loc);
+      }
+
+      void visit_Atom(Atom_syntax* s)
+      {
+        s->m_tok = move(s->m_tok);
+      }
+
+      void visit_Enclosure(Enclosure_syntax* s)
+      {
+        s->m_open = move(s->m_open);
+        s->m_close = move(s->m_close);
+      }
+
+      // A body that has already been parsed may have looked past its
+      // closing brace, at tokens that have since changed. Destroy it and
+      // defer it again, so it is parsed from the new tokens when accessed.
+      void visit_Deferred(Deferred_syntax* s)
+      {
+        std::size_t pos = s->is_deferred() ? s->m_pos : find_token(a, s->m_open.start_location());
+        visit_Enclosure(s);
+        destroy(s->m_term);
+        s->m_term = nullptr;
+        s->m_pos = d.map(pos);
+        s->m_parser = p->body_parser();
+      }
+
+      void visit_Prefix(Prefix_syntax* s)
+      {
+        s->m_op = move(s->m_op);
+      }
+
+      void visit_Postfix(Postfix_syntax* s)
+      {
+        s->m_op = move(s->m_op);
+      }
+
+      void visit_Infix(Infix_syntax* s)
+      {
+        s->m_op = move(s->m_op);
+      }
+
+      void visit_Constructor(Constructor_syntax* s)
+      {
+        s->m_ctor = move(s->m_ctor);
+      }
+
+      void visit_Declaration(Declaration_syntax* s)
+      {
+        s->m_tok = move(s->m_tok);
+      }
+
+      void relocate(Syntax* s)
+      {
+        visit(s);
+        for (Syntax* c : s->children())
+          if (c)
+            relocate(c);
+      }
+
+      Token_diff const& d;
+      Token_stream const& a;
+      Token_stream const& b;
+      Parser* p;
+    };
+  } // namespace
+
+  void relocate(Syntax* s,
+                Token_diff const& d,
+                Token_stream const& a,
+                Token_stream const& b,
+                Parser* p)
+  {
+    Relocator r{{}, d, a, b, p};
+    r.relocate(s);
+  }
+
+} // namespace beaker
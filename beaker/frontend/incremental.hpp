@@ -0,0 +1,80 @@
+#ifndef BEAKER_FRONTEND_INCREMENTAL_HPP
+#define BEAKER_FRONTEND_INCREMENTAL_HPP
+
+#include <beaker/frontend/syntax.hpp>
+
+#include <vector>
+
+namespace beaker
+{
+  struct Parser;
+  struct Token_stream;
+
+  // Incremental reparsing
+  //
+  // An edit is recovered by comparing the token streams of the old and new
+  // text: tokens in their common prefix and suffix are unchanged, except
+  // that tokens in the suffix may have moved. A top-level declaration of
+  // the old tree can be reused if its tokens, its bracket matches, and the
+  // tokens that its parse may have looked at after it are all unchanged.
+
+  /// The difference between two token streams.
+  struct Token_diff
+  {
+    /// Returns the position in the new stream of the old token `n`, or
+    /// `npos` if the token was changed.
+    std::size_t map(std::size_t n) const
+    {
+      if (n < prefix)
+        return n;
+      if (n >= old_size - suffix)
+        return n - old_size + new_size;
+      return npos;
+    }
+
+    /// Returns the position in the old stream of the new token `n`, or
+    /// `npos` if the token was changed.
+    std::size_t unmap(std::size_t n) const
+    {
+      if (n < prefix)
+        return n;
+      if (n >= new_size - suffix)
+        return n - new_size + old_size;
+      return npos;
+    }
+
+    static constexpr std::size_t npos = -1;
+
+    std::size_t old_size;
+    std::size_t new_size;
+    std::size_t prefix; // The length of the common prefix.
+    std::size_t suffix; // The length of the common suffix.
+  };
+
+  /// Returns the difference between the old and new token streams.
+  Token_diff diff_tokens(Token_stream const& a, Token_stream const& b);
+
+  /// Returns the position of the first token of each declaration in `decls`,
+  /// which was parsed from `toks`.
+  std::vector<std::size_t> declaration_starts(Syntax const* decls, Token_stream const& toks);
+
+  /// Returns true if the declaration spanning the old tokens `[first, last)`
+  /// can be reused in the new stream.
+  bool is_reusable(Token_diff const& d,
+                   Token_stream const& a,
+                   Token_stream const& b,
+                   std::size_t first,
+                   std::size_t last);
+
+  /// Moves the tokens of the reused tree `s` from the old stream to the new
+  /// one. Deferred bodies, parsed or not, are deferred again and bound to the
+  /// body parser of `p`, which parses the new stream.
+  void relocate(Syntax* s,
+                Token_diff const& d,
+                Token_stream const& a,
+                Token_stream const& b,
+                Parser* p);
+
+} // namespace beaker
+
+#endif
@@ -8,7 +8,7 @@
 
 namespace beaker
 {
-  static std::string read_file(std::filesystem::path const& p)
+  std::string read_file(std::filesystem::path const& p)
   {
     std::ifstream ifs(p);
     std::istreambuf_iterator<char> first(ifs);
@@ -17,7 +17,11 @@ namespace beaker
   }
 
   Lexer::Lexer(Translation& trans, std::filesystem::path const& p)
-    : m_trans(trans), m_path(p), m_text(read_file(p)), m_pos(0), m_line_pos(0), m_line(1)
+    : Lexer(trans, p, read_file(p))
+  { }
+
+  Lexer::Lexer(Translation& trans, std::filesystem::path const& p, std::string text)
+    : m_trans(trans), m_path(p), m_text(std::move(text)), m_pos(0), m_line_pos(0), m_line(1)
   {
     // Build the keyowrd table.
 #define def_keyword(K) \
@@ -28,6 +32,51 @@ namespace beaker
     // to seriously adjust the lexing rules if we're in UTF-16 or UTF-32.
   }
 
+  void Lexer::reset(std::filesystem::path const& p, std::string_view text)
+  {
+    m_path = p;
+    m_input = nullptr;
+    m_text.assign(text);
+    m_pos = 0;
+    m_line_pos = 0;
+    m_line = 1;
+  }
+
+  Lexer::Lexer(Translation& trans, std::filesystem::path const& p, std::istream& is)
+    : Lexer(trans, p, std::string())
+  {
+    m_input = &is;
+  }
+
+  bool Lexer::refill()
+  {
+    if (!m_input || !*m_input)
+      return false;
+
+    // Drop the lexed text, except for the start of the current line, which
+    // locates the characters after it.
+    m_text.erase(0, m_line_pos);
+    m_pos -= m_line_pos;
+    m_line_pos = 0;
+
+    // Blocks end at the end of a line, so no token or comment is split
+    // across blocks.
+    constexpr std::size_t block_size = 1 << 16;
+    std::size_t n = m_text.size();
+    m_text.resize(n + block_size);
+    m_input->read(m_text.data() + n, block_size);
+    m_text.resize(n + m_input->gcount());
+    if (m_text.size() != n && m_text.back() != '\n') {
+      std::string rest;
+      if (std::getline(*m_input, rest)) {
+        m_text += rest;
+        if (!m_input->eof())
+          m_text += '\n';
+      }
+    }
+    return m_pos < m_text.size();
+  }
+
   static void skip_space(Lexer& lex)
   {
     // Update line information.
@@ -87,7 +136,7 @@ namespace beaker
 
   Token Lexer::get()
   {
-    while (m_pos < m_text.size()) {
+    while (m_pos < m_text.size() || refill()) {
       char c = m_text[m_pos];
 
       // Handle things that would be insignificant.
@@ -111,7 +160,9 @@ namespace beaker
         return get_puncop(*this);
       }
     }
-    return {};
+
+    // The end-of-file token is located at the end of the input.
+    return Token(Token::eof_tok, m_trans.get_symbol(""), input_location());
   }
 
   Token Word_scanner::get()
@@ -239,4 +290,52 @@ namespace beaker
     return get_invalid(*this);
   }
 
+  std::vector<std::size_t> match_brackets(std::span<Token const> toks)
+  {
+    std::vector<std::size_t> matches;
+    Bracket_matcher m;
+    m.match(toks, matches);
+    return matches;
+  }
+
+  void Bracket_matcher::match(std::span<Token const> toks, std::vector<std::size_t>& matches)
+  {
+    matches.assign(toks.size(), toks.size());
+    for (std::vector<std::size_t>& stack : m_stacks)
+      stack.clear();
+
+    auto close = [&](std::vector<std::size_t>& stack, std::size_t n) {
+      if (stack.empty())
+        return;
+      matches[stack.back()] = n;
+      matches[n] = stack.back();
+      stack.pop_back();
+    };
+
+    for (std::size_t n = 0; n < toks.size(); ++n) {
+      switch (toks[n].kind()) {
+      case Token::lparen_tok:
+        m_stacks[0].push_back(n);
+        break;
+      case Token::lbracket_tok:
+        m_stacks[1].push_back(n);
+        break;
+      case Token::lbrace_tok:
+        m_stacks[2].push_back(n);
+        break;
+      case Token::rparen_tok:
+        close(m_stacks[0], n);
+        break;
+      case Token::rbracket_tok:
+        close(m_stacks[1], n);
+        break;
+      case Token::rbrace_tok:
+        close(m_stacks[2], n);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
 } // namespace beaker
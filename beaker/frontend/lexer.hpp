@@ -5,6 +5,10 @@
 #include <beaker/frontend/token.hpp>
 
 #include <filesystem>
+#include <iosfwd>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace beaker
 {
@@ -92,7 +96,20 @@ namespace beaker
   {
     Lexer(Translation& trans, std::filesystem::path const& p);
 
-    /// Returns the next token.
+    /// Lexes `text` as the contents of the file `p` (e.g., an unsaved
+    /// editor buffer).
+    Lexer(Translation& trans, std::filesystem::path const& p, std::string text);
+
+    /// Lexes the file `p` from `is`, which is read a block of lines at a
+    /// time, so the whole file is never in memory.
+    Lexer(Translation& trans, std::filesystem::path const& p, std::istream& is);
+
+    /// Lexes `text` as the contents of the file `p`, reusing the keyword
+    /// table and the storage of the previous text.
+    void reset(std::filesystem::path const& p, std::string_view text);
+
+    /// Returns the next token. At the end of input, this returns an
+    /// end-of-file token located at the end of the input.
     Token get();
 
     /// Read all tokens into the output buffer.
@@ -109,17 +126,42 @@ namespace beaker
       return {m_line, m_pos - m_line_pos};
     }
 
+    /// Reads the next block of lines from the input stream, if any, into
+    /// the text. Returns false at the end of input.
+    bool refill();
+
     using Keyword_table = std::unordered_map<Symbol, Token::Kind>;
 
     Translation& m_trans;
     Keyword_table m_keywords;
     std::filesystem::path m_path;
+    std::istream* m_input = nullptr;
     std::string m_text;
     std::size_t m_pos;
     std::size_t m_line_pos;
     std::size_t m_line;
   };
 
+  /// Returns the contents of the file `p`.
+  std::string read_file(std::filesystem::path const& p);
+
+  /// Returns a table that maps the index of each bracket in `toks` to the
+  /// index of its matching bracket. Parens, brackets, and braces are matched
+  /// independently of each other. Unmatched brackets, and tokens that are
+  /// not brackets, map to `toks.size()`.
+  std::vector<std::size_t> match_brackets(std::span<Token const> toks);
+
+  /// Matches brackets like `match_brackets`, reusing the storage of the
+  /// table and the stacks of open brackets across inputs.
+  struct Bracket_matcher
+  {
+    /// Replaces `matches` with the table for `toks`.
+    void match(std::span<Token const> toks, std::vector<std::size_t>& matches);
+
+    // The indexes of the open parens, brackets, and braces.
+    std::vector<std::size_t> m_stacks[3];
+  };
+
 } // namespace beaker
 
 #endif
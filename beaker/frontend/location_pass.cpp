@@ -0,0 +1,23 @@
+#include <beaker/frontend/location_pass.hpp>
+
+#include <algorithm>
+
+namespace beaker
+{
+  void Location_pass::leave_Syntax(Syntax const* s)
+  {
+    // The ranges of the non-null children are the last ones computed.
+    Const_syntax_span kids = s->children();
+    std::size_t n = std::count_if(kids.begin(), kids.end(), [](Syntax const* k) {
+      return k != nullptr;
+    });
+    std::size_t first = m_ranges.size() - n;
+    m_kids.assign(kids.size(), Source_range());
+    for (std::size_t i = 0, j = first; i < kids.size(); ++i)
+      if (kids[i])
+        m_kids[i] = m_ranges[j++];
+    m_ranges.resize(first);
+    m_ranges.push_back(s->location(m_kids.data()));
+  }
+
+} // namespace beaker
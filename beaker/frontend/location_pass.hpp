@@ -0,0 +1,75 @@
+#ifndef BEAKER_FRONTEND_LOCATION_PASS_HPP
+#define BEAKER_FRONTEND_LOCATION_PASS_HPP
+
+#include <beaker/frontend/traversal.hpp>
+
+#include <vector>
+
+namespace beaker
+{
+  /// Computes the range of each node from the ranges of its children, after
+  /// they have been visited. Computing the ranges of a tree this way takes
+  /// time linear in its size, whereas calling `location()` on every node
+  /// takes time proportional to its size times its depth.
+  ///
+  /// When fused with other passes, the range of a node is available to the
+  /// `leave_T` hooks of passes that follow this one.
+  struct Location_pass : Const_syntax_pass<Location_pass>
+  {
+    void leave_Syntax(Syntax const* s);
+
+    /// Returns the range of the node most recently left.
+    Source_range range() const
+    {
+      return m_ranges.back();
+    }
+
+    // The ranges of the nodes that have been left but whose parents have
+    // not, in the order they were left.
+    std::vector<Source_range> m_ranges;
+
+    // The ranges of the children of the node being left.
+    std::vector<Source_range> m_kids;
+  };
+
+  /// Stores the range of each node at its position in pre-order. This must
+  /// follow `locs` in a fused traversal.
+  struct Preorder_location_pass : Const_syntax_pass<Preorder_location_pass>
+  {
+    Preorder_location_pass(Location_pass const& locs)
+      : locs(locs)
+    { }
+
+    void visit_Syntax(Syntax const* s)
+    {
+      m_stack.push_back(m_ranges.size());
+      m_ranges.emplace_back();
+    }
+
+    void leave_Syntax(Syntax const* s)
+    {
+      m_ranges[m_stack.back()] = locs.range();
+      m_stack.pop_back();
+    }
+
+    Location_pass const& locs;
+    std::vector<Source_range> m_ranges;
+
+    // The positions of the nodes enclosing the current node.
+    std::vector<std::size_t> m_stack;
+  };
+
+  /// Returns the ranges of `s` and its non-null subtrees in pre-order. The
+  /// passes `ps`, if any, are run in the same traversal.
+  template<typename... Ps>
+  std::vector<Source_range> locations(Syntax const* s, Ps&... ps)
+  {
+    Location_pass locs;
+    Preorder_location_pass pre(locs);
+    traverse(s, locs, pre, ps...);
+    return std::move(pre.m_ranges);
+  }
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,55 @@
+#include <beaker/frontend/mapped_file.hpp>
+
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace beaker
+{
+  Mapped_file::Mapped_file(std::filesystem::path const& p)
+  {
+    int fd = ::open(p.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("cannot open '" + p.string() + "'");
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+      ::close(fd);
+      throw std::runtime_error("cannot stat '" + p.string() + "'");
+    }
+
+    // Empty files cannot be mapped, but they are still valid files.
+    m_size = st.st_size;
+    if (m_size != 0) {
+      void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("cannot map '" + p.string() + "'");
+      }
+      m_data = static_cast<char const*>(addr);
+    }
+    ::close(fd);
+  }
+
+  Mapped_file::Mapped_file(Mapped_file&& x)
+    : m_data(std::exchange(x.m_data, nullptr)), m_size(std::exchange(x.m_size, 0))
+  { }
+
+  Mapped_file& Mapped_file::operator=(Mapped_file&& x)
+  {
+    std::swap(m_data, x.m_data);
+    std::swap(m_size, x.m_size);
+    return *this;
+  }
+
+  Mapped_file::~Mapped_file()
+  {
+    if (m_data)
+      ::munmap(const_cast<char*>(m_data), m_size);
+  }
+
+} // namespace beaker
@@ -0,0 +1,44 @@
+#ifndef BEAKER_FRONTEND_MAPPED_FILE_HPP
+#define BEAKER_FRONTEND_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace beaker
+{
+  /// A read-only memory mapping of a file. The contents of the file are
+  /// paged in on demand, so mapping large files is cheap.
+  struct Mapped_file
+  {
+    Mapped_file() = default;
+    Mapped_file(std::filesystem::path const& p);
+    Mapped_file(Mapped_file&& x);
+    Mapped_file& operator=(Mapped_file&& x);
+    ~Mapped_file();
+
+    /// Returns a pointer to the first byte of the file.
+    char const* data() const
+    {
+      return m_data;
+    }
+
+    /// Returns the size of the file in bytes.
+    std::size_t size() const
+    {
+      return m_size;
+    }
+
+    /// Returns the contents of the file.
+    std::string_view str() const
+    {
+      return {m_data, m_size};
+    }
+
+    char const* m_data = nullptr;
+    std::size_t m_size = 0;
+  };
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,51 @@
+#include <beaker/frontend/node_table.hpp>
+#include <beaker/frontend/traversal.hpp>
+
+namespace beaker
+{
+  namespace
+  {
+    // Assigns ids in pre-order. The stack holds the ids of the nodes
+    // enclosing the current node.
+    struct Numbering_pass : Const_syntax_pass<Numbering_pass>
+    {
+      Numbering_pass(Node_table& t)
+        : t(t)
+      { }
+
+      void visit_Syntax(Syntax const* s)
+      {
+        Node_id n = t.m_nodes.size();
+        Node_id p = stack.empty() ? no_node : stack.back();
+        t.m_nodes.push_back({s, p, std::uint32_t(stack.size())});
+        s->m_id = n;
+        stack.push_back(n);
+      }
+
+      void leave_Syntax(Syntax const* s)
+      {
+        stack.pop_back();
+      }
+
+      Node_table& t;
+      std::vector<Node_id> stack;
+    };
+  } // namespace
+
+  Node_table::Node_table(Syntax const* root)
+  {
+    if (!root)
+      return;
+    Numbering_pass pass(*this);
+    traverse(root, pass);
+  }
+
+  Syntax const* Node_table::enclosing(Syntax const* s, Syntax::Kind k) const
+  {
+    for (Node_id n = parent(id(s)); n != no_node; n = parent(n))
+      if (node(n)->kind() == k)
+        return node(n);
+    return nullptr;
+  }
+
+} // namespace beaker
@@ -0,0 +1,137 @@
+#ifndef BEAKER_FRONTEND_NODE_TABLE_HPP
+#define BEAKER_FRONTEND_NODE_TABLE_HPP
+
+#include <beaker/frontend/syntax.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace beaker
+{
+  /// The identity of a node within a tree. Ids are dense and assigned in
+  /// pre-order, so the root is 0.
+  using Node_id = std::uint32_t;
+
+  /// The id of no node (e.g., the parent of the root).
+  constexpr Node_id no_node = -1;
+
+  /// A side table that assigns ids to the nodes of a tree and records the
+  /// parent and depth of each node.
+  ///
+  /// The table is built when it is constructed and not modified after, so
+  /// it can be shared by threads. Building the table also stores the id of
+  /// each node in the node, so that finding the id of a node takes constant
+  /// time. As a result, only the table most recently built for a tree (or
+  /// for a tree containing it) can be queried by node, and tables must not
+  /// be built for a tree while other threads query one by node.
+  struct Node_table
+  {
+    /// Builds the table for the tree `root`, which may be null. The table
+    /// for a null tree is empty.
+    Node_table(Syntax const* root);
+
+    /// Returns the root of the tree, or null if the table is empty.
+    Syntax const* root() const
+    {
+      return m_nodes.empty() ? nullptr : m_nodes[0].node;
+    }
+
+    /// Returns the number of nodes in the tree.
+    std::size_t size() const
+    {
+      return m_nodes.size();
+    }
+
+    /// Returns the id of `s`, which must be in the tree.
+    Node_id id(Syntax const* s) const
+    {
+      Node_id n = s->m_id;
+      assert(n < m_nodes.size() && m_nodes[n].node == s);
+      return n;
+    }
+
+    /// Returns the node with id `n`.
+    Syntax const* node(Node_id n) const
+    {
+      return m_nodes[n].node;
+    }
+
+    /// Returns the id of the parent of `n`, or `no_node` for the root.
+    Node_id parent(Node_id n) const
+    {
+      return m_nodes[n].parent;
+    }
+
+    /// Returns the parent of `s`, or null for the root.
+    Syntax const* parent(Syntax const* s) const
+    {
+      Node_id p = parent(id(s));
+      return p != no_node ? node(p) : nullptr;
+    }
+
+    /// Returns the depth of `n`. The depth of the root is 0.
+    std::uint32_t depth(Node_id n) const
+    {
+      return m_nodes[n].depth;
+    }
+
+    /// Returns the nearest proper ancestor of `s` of kind `k`, or null if
+    /// there is no such node.
+    Syntax const* enclosing(Syntax const* s, Syntax::Kind k) const;
+
+    struct Entry
+    {
+      Syntax const* node;
+      Node_id parent;
+      std::uint32_t depth;
+    };
+
+    std::vector<Entry> m_nodes;
+  };
+
+  /// Associates a value of type T with each node of a tree. Values are
+  /// stored contiguously and indexed by node id.
+  template<typename T>
+  struct Node_map
+  {
+    Node_map(Node_table const& t, T const& value = T())
+      : m_table(t), m_values(t.size(), value)
+    { }
+
+    /// Returns the value for the node `n`.
+    T& operator[](Node_id n)
+    {
+      return m_values[n];
+    }
+
+    /// Returns the value for the node `n`.
+    T const& operator[](Node_id n) const
+    {
+      return m_values[n];
+    }
+
+    /// Returns the value for `s`.
+    T& operator[](Syntax const* s)
+    {
+      return m_values[m_table.id(s)];
+    }
+
+    /// Returns the value for `s`.
+    T const& operator[](Syntax const* s) const
+    {
+      return m_values[m_table.id(s)];
+    }
+
+    /// Returns the number of values, which is the number of nodes.
+    std::size_t size() const
+    {
+      return m_values.size();
+    }
+
+    Node_table const& m_table;
+    std::vector<T> m_values;
+  };
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,97 @@
+#include <beaker/frontend/parse_profile.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+namespace beaker
+{
+  // The names of interned productions, indexed by identifier.
+  static std::mutex names_mutex;
+  static std::vector<char const*> names;
+
+  std::size_t Parse_profile::intern(char const* name)
+  {
+    std::lock_guard<std::mutex> lock(names_mutex);
+    for (std::size_t i = 0; i < names.size(); ++i)
+      if (std::string_view(names[i]) == name)
+        return i;
+    names.push_back(name);
+    return names.size() - 1;
+  }
+
+  void Parse_profile::note_lookahead(std::size_t n)
+  {
+    ++m_distances[std::bit_width(n)];
+    if (m_stack.empty())
+      return;
+    Production_profile& p = m_prods[m_stack.back()];
+    ++p.lookaheads;
+    p.max_lookahead = std::max(p.max_lookahead, n);
+  }
+
+  void Parse_profile::merge(Parse_profile const& x)
+  {
+    if (x.m_prods.size() > m_prods.size())
+      m_prods.resize(x.m_prods.size());
+    for (std::size_t i = 0; i < x.m_prods.size(); ++i) {
+      Production_profile& p = m_prods[i];
+      Production_profile const& q = x.m_prods[i];
+      p.calls += q.calls;
+      p.tokens += q.tokens;
+      p.time += q.time;
+      p.lookaheads += q.lookaheads;
+      p.max_lookahead = std::max(p.max_lookahead, q.max_lookahead);
+    }
+    for (std::size_t i = 0; i < std::size(m_distances); ++i)
+      m_distances[i] += x.m_distances[i];
+  }
+
+  void Parse_profile::print(std::ostream& os) const
+  {
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < m_prods.size(); ++i)
+      if (m_prods[i].calls != 0)
+        order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+      return m_prods[a].time > m_prods[b].time;
+    });
+
+    std::vector<char const*> prod_names;
+    {
+      std::lock_guard<std::mutex> lock(names_mutex);
+      prod_names = names;
+    }
+
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "   time (ms)       calls      tokens  lookaheads   max  production\n";
+    for (std::size_t i : order) {
+      Production_profile const& p = m_prods[i];
+      os << std::setw(12) << std::chrono::duration<double, std::milli>(p.time).count()
+         << std::setw(12) << p.calls
+         << std::setw(12) << p.tokens
+         << std::setw(12) << p.lookaheads
+         << std::setw(6) << p.max_lookahead
+         << "  " << prod_names[i] << '\n';
+    }
+
+    os << "  lookaheads  distance\n";
+    for (std::size_t w = 0; w < std::size(m_distances); ++w) {
+      if (m_distances[w] == 0)
+        continue;
+      os << std::setw(12) << m_distances[w] << "  ";
+      if (w <= 1)
+        os << w << '\n';
+      else
+        os << (std::size_t(1) << (w - 1)) << '-' << (std::size_t(1) << w) - 1 << '\n';
+    }
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+} // namespace beaker
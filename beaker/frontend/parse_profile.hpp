@@ -0,0 +1,122 @@
+#ifndef BEAKER_FRONTEND_PARSE_PROFILE_HPP
+#define BEAKER_FRONTEND_PARSE_PROFILE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace beaker
+{
+  // Production profiling
+  //
+  // When built with BEAKER_PARSER_PROFILE defined, each production of the
+  // parser is marked by BEAKER_PROFILE_PRODUCTION, which counts its calls,
+  // the tokens it consumes, and its inclusive time, and attributes the
+  // lookahead of `peek(n)` and `find_matching` to the innermost running
+  // production. Otherwise, the marks expand to nothing.
+  //
+  // Productions are identified by the name of their function, so a
+  // production of the same name in a base and a derived grammar is
+  // reported once.
+
+  /// The costs of one production.
+  struct Production_profile
+  {
+    using Duration = std::chrono::nanoseconds;
+
+    std::uint64_t calls = 0;
+    std::uint64_t tokens = 0;
+    Duration time{};
+    std::uint64_t lookaheads = 0;
+    std::size_t max_lookahead = 0;
+
+    // The number of running calls. Only the outermost of recursive calls
+    // adds its tokens and time, so they are not counted twice.
+    std::size_t active = 0;
+    std::chrono::steady_clock::time_point start;
+    std::size_t start_pos;
+  };
+
+  /// The costs of each production of a parser.
+  struct Parse_profile
+  {
+    /// Returns the identifier of the production named `name`, which must
+    /// have static storage. Identifiers are shared by all profiles.
+    static std::size_t intern(char const* name);
+
+    /// Records a call to the production `id` at the token `pos`.
+    void enter(std::size_t id, std::size_t pos)
+    {
+      if (id >= m_prods.size())
+        m_prods.resize(id + 1);
+      Production_profile& p = m_prods[id];
+      ++p.calls;
+      if (p.active++ == 0) {
+        p.start = std::chrono::steady_clock::now();
+        p.start_pos = pos;
+      }
+      m_stack.push_back(id);
+    }
+
+    /// Records the return of the production `id` at the token `pos`.
+    void leave(std::size_t id, std::size_t pos)
+    {
+      m_stack.pop_back();
+      Production_profile& p = m_prods[id];
+      if (--p.active == 0) {
+        p.time += std::chrono::steady_clock::now() - p.start;
+        if (pos > p.start_pos)
+          p.tokens += pos - p.start_pos;
+      }
+    }
+
+    /// Records a lookahead of `n` tokens past the current one.
+    void note_lookahead(std::size_t n);
+
+    /// Adds the costs of `x`, which must not be running any production.
+    void merge(Parse_profile const& x);
+
+    /// Writes the productions as a table, most costly first, followed by
+    /// the number of lookaheads of each distance.
+    void print(std::ostream& os) const;
+
+    /// Records a call of a production for the duration of a scope.
+    struct Scope
+    {
+      Scope(Parse_profile& p, std::size_t id, std::size_t const& pos)
+        : m_profile(p), m_id(id), m_pos(pos)
+      {
+        m_profile.enter(m_id, m_pos);
+      }
+
+      Scope(Scope const&) = delete;
+
+      ~Scope()
+      {
+        m_profile.leave(m_id, m_pos);
+      }
+
+      Parse_profile& m_profile;
+      std::size_t m_id;
+      std::size_t const& m_pos;
+    };
+
+    std::vector<Production_profile> m_prods;
+    std::vector<std::size_t> m_stack;
+
+    // The number of lookaheads whose distance has each bit width.
+    std::uint64_t m_distances[65] = {};
+  };
+
+} // namespace beaker
+
+#ifdef BEAKER_PARSER_PROFILE
+#  define BEAKER_PROFILE_PRODUCTION() \
+     static std::size_t const beaker_production = ::beaker::Parse_profile::intern(__func__); \
+     ::beaker::Parse_profile::Scope beaker_production_scope(this->m_profile, beaker_production, this->m_pos)
+#else
+#  define BEAKER_PROFILE_PRODUCTION()
+#endif
+
+#endif
@@ -1,141 +1,233 @@
 #include <beaker/frontend/parser.hpp>
 
+#include <beaker/language/timer.hpp>
+
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
 namespace beaker
 {
   Parser::Parser(Translation& trans, std::filesystem::path const& p)
-    : m_trans(trans), m_lex(trans, p)
+    : Parser(trans, p, read_file(p))
+  { }
+
+  Parser::Parser(Translation& trans, std::filesystem::path const& p, std::string text)
+    : m_trans(trans), m_diags(&trans.diagnostics())
   {
     // Tokenize the input and point to the first token.
-    m_lex.get(m_toks);
+    m_lexer = std::make_shared<Lexer>(trans, p, std::move(text));
+    lex_tokens();
+
+    // Build the default table of infix operators.
+    using enum Associativity;
+    m_infix.set(Token::equal_tok, assignment_precedence, right);
+    m_infix.set(Token::dash_greater_tok, implication_precedence, right);
+    m_infix.set(Token::or_tok, logical_or_precedence);
+    m_infix.set(Token::and_tok, logical_and_precedence);
+    m_infix.set(Token::equal_equal_tok, equality_precedence);
+    m_infix.set(Token::bang_equal_tok, equality_precedence);
+    m_infix.set(Token::less_tok, relational_precedence);
+    m_infix.set(Token::greater_tok, relational_precedence);
+    m_infix.set(Token::less_equal_tok, relational_precedence);
+    m_infix.set(Token::greater_equal_tok, relational_precedence);
+    m_infix.set(Token::plus_tok, additive_precedence);
+    m_infix.set(Token::dash_tok, additive_precedence);
+    m_infix.set(Token::star_tok, multiplicative_precedence);
+    m_infix.set(Token::slash_tok, multiplicative_precedence);
+    m_infix.set(Token::percent_tok, multiplicative_precedence);
+  }
+
+  void Parser::reset(std::filesystem::path const& p, std::string_view text)
+  {
+    m_lexer->reset(p, text);
+    lex_tokens();
+  }
+
+  /// Lexes the text of the lexer, and points to the first token.
+  void Parser::lex_tokens()
+  {
+    Timer timer(m_trans.time_report(), "lex");
+    m_bodies = nullptr;
+    std::shared_ptr<Token_stream> stream;
+    if (m_stream.use_count() == 1)
+      stream = std::const_pointer_cast<Token_stream>(m_stream);
+    else
+      stream = std::make_shared<Token_stream>();
+    stream->toks.clear();
+    m_lexer->get(stream->toks);
+    stream->eof = m_lexer->get();
+    m_matcher.match(stream->toks, stream->matches);
+    m_stream = stream;
+    m_toks = stream->toks;
+    m_matches = stream->matches;
+    m_eof = stream->eof;
     m_pos = 0;
+    m_max_lookahead = 0;
+    m_recovering = false;
+    m_depth = 0;
+    m_memo.clear();
+    m_source = nullptr;
+    m_limit = 0;
+  }
+
+  std::shared_ptr<Parser> const& Parser::body_parser()
+  {
+    Parser* root = m_root;
+    if (!root->m_bodies) {
+      // The copy starts in the state of a finished parse, and parses bodies
+      // completely, so it never defers them to itself.
+      std::shared_ptr<Parser> p = root->copy();
+      p->m_root = p.get();
+      p->m_diags = &m_trans.diagnostics();
+      p->m_recovering = false;
+      p->m_depth = 0;
+      p->m_speculating = 0;
+      p->m_lazy = false;
+#ifdef BEAKER_PARSER_PROFILE
+      p->m_profile = {};
+#endif
+      root->m_bodies = std::move(p);
+    }
+    return root->m_bodies;
   }
 
-  Syntax* Parser::parse_file()
+  Parser::Parser(Translation& trans, std::filesystem::path const& p, std::istream& is)
+    : Parser(trans, p, std::string())
   {
-    Syntax* s = parse_declaration_seq();
-    return new File_syntax(s);
+    set_input(p, is);
   }
 
-  Syntax* Parser::parse_declaration_seq()
+  void Parser::set_input(std::filesystem::path const& p, std::istream& is)
   {
-    Syntax_seq ss;
-    while (!eof())
-      parse_item(*this, &Parser::parse_declaration, ss);
-    return new Sequence_syntax(std::move(ss));
+    m_source = std::make_shared<Token_source>(m_trans, p, is);
+    m_pos = 0;
+    m_limit = 0;
   }
 
-  Syntax* Parser::parse_declaration()
+  bool Token_source::get()
   {
-    switch (lookahead()) {
+    if (done)
+      return false;
+    Token tok = lex.get();
+    if (!tok) {
+      eof = tok;
+      done = true;
+      return false;
+    }
+
+    switch (tok.kind()) {
+    case Token::lparen_tok:
+      ++depth[0];
+      break;
+    case Token::lbracket_tok:
+      ++depth[1];
+      break;
+    case Token::lbrace_tok:
+      ++depth[2];
+      break;
+    case Token::rparen_tok:
+      if (depth[0] != 0)
+        --depth[0];
+      break;
+    case Token::rbracket_tok:
+      if (depth[1] != 0)
+        --depth[1];
+      break;
+    case Token::rbrace_tok:
+      if (depth[2] != 0)
+        --depth[2];
+      break;
     case Token::def_tok:
-      return parse_definition();
+      if (depth[0] == 0 && depth[1] == 0 && depth[2] == 0)
+        starts.push_back(toks.size());
+      break;
     default:
       break;
     }
-
-    // FIXME: Return an error node. Also, how do we recover? We've got
-    // tokens not belonging to any particular declaration, so what would
-    // we skip to.
-    diagnose_expected("declaration");
-    return nullptr;
+    toks.push_back(tok);
+    return true;
   }
 
-  /// Definition declaration:
-  ///
-  ///   definition-declaration:
-  ///     def declarator-list : type ;
-  ///     def declarator-list : initializer
-  ///     def declarator-list : type initializer
-  ///
-  ///   initializer:
-  ///     = expression ;
-  ///     { statement-list }
-  ///
-  /// TODO: Support brace initialization `def x : t { ... }`, although I'm
-  /// not sure what the grammar of `...` is. A sequence of statements? A
-  /// list of expressions. We can probably build a single grammar that supports
-  /// both.
-  Syntax* Parser::parse_definition()
+  /// Releases the tokens before the current token, which starts a
+  /// declaration, and lexes the tokens of that declaration.
+  void Parser::release_tokens()
   {
-    Token intro = require(Token::def_tok);
-
-    // Parse the declarator
-    Syntax* decl = parse_declarator_list();
-
-    // Parse the type.
-    expect(Token::colon_tok);
-    
-    Syntax* type = nullptr;
-    if (next_token_is_not(Token::equal_tok)) {
-      type = parse_type();
-
-      // Match the 'decl : type ;' case.
-      if (match(Token::semicolon_tok))
-        return new Declaration_syntax(intro, decl, type, nullptr);
-
-      // Fall through to parse the initializer.
-    }
-
-    // Parse the initializer.
-    Syntax* init;
-    if (match(Token::equal_tok)) {
-      init = parse_expression();
-      expect(Token::semicolon_tok);
-    }
-    else if (next_token_is(Token::lbrace_tok)) {
-      init = parse_brace_list();
-    }
-    else {
-      diagnose_expected("initializer");
-    }
-
-    return new Declaration_syntax(intro, decl, type, init);
+    Token_source& src = *m_source;
+    src.toks.erase(src.toks.begin(), src.toks.begin() + m_pos);
+    std::erase_if(src.starts, [this](std::size_t n) { return n < m_pos; });
+    for (std::size_t& n : src.starts)
+      n -= m_pos;
+    m_pos = 0;
+    extend_tokens(0);
   }
 
-  /// Parser a parameter:
-  ///
-  ///   parameter:
-  ///     identifier : type
-  ///     identifier : type = expression
-  ///     identifeir : = expression
-  ///     : type
-  ///     : type = expression
-  ///
-  /// TODO: Can parameters have introducers?
+  /// Lexes tokens through the first declaration starting after the token
+  /// `n`, which becomes the limit of the current declaration. Two more tokens
+  /// are lexed, which is as far as any grammar looks past that limit.
   ///
-  /// TODO: Can paramters be packs (yes, but what's the syntax?).
-  Syntax* Parser::parse_parameter()
+  /// No bracket before the limit is matched after it, so brackets are matched
+  /// the same way as in the whole file.
+  void Parser::extend_tokens(std::size_t n)
   {
-    // Match unnamed variants.
-    if (match(Token::colon_tok)) {
-      Syntax* type = parse_type();
-      Syntax* init = nullptr;
-      if (match(Token::equal_tok))
-        init = parse_expression();
-      return new Declaration_syntax({}, nullptr, type, init);
-    }
-
-    // Match the identifier...
-    Syntax* id = parse_id_expression();
-    
-    // ... And optional declarative information
-    Syntax* type = nullptr;
-    Syntax* init = nullptr;
-    if (match(Token::colon_tok)) {
-      if (next_token_is_not(Token::equal_tok))
-        type = parse_type();
-      if (match(Token::equal_tok))
-        init = parse_expression();
+    Token_source& src = *m_source;
+    auto next = [&src, n]() {
+      return std::upper_bound(src.starts.begin(), src.starts.end(), n);
+    };
+    while (next() == src.starts.end() && src.get())
+      ;
+    m_limit = next() != src.starts.end() ? *next() : src.toks.size();
+    while (src.toks.size() < m_limit + 2 && src.get())
+      ;
+
+    auto stream = std::make_shared<Token_stream>();
+    stream->toks = src.toks;
+    m_matcher.match(stream->toks, stream->matches);
+    if (src.done)
+      stream->eof = src.eof;
+    else
+      stream->eof = Token(Token::eof_tok, {}, src.lex.input_location());
+    m_stream = stream;
+    m_toks = stream->toks;
+    m_matches = stream->matches;
+    m_eof = stream->eof;
+    m_memo.clear();
+  }
+
+  /// Returns the positions of tokens that likely start top-level
+  /// declarations: the first token, and each `def` not enclosed in brackets.
+  std::vector<std::size_t> Parser::find_declarations() const
+  {
+    std::vector<std::size_t> starts;
+    if (!m_toks.empty())
+      starts.push_back(0);
+    std::size_t depth = 0;
+    for (std::size_t i = 0; i < m_toks.size(); ++i) {
+      switch (m_toks[i].kind()) {
+      case Token::lparen_tok:
+      case Token::lbracket_tok:
+      case Token::lbrace_tok:
+        ++depth;
+        break;
+      case Token::rparen_tok:
+      case Token::rbracket_tok:
+      case Token::rbrace_tok:
+        if (depth != 0)
+          --depth;
+        break;
+      case Token::def_tok:
+        if (depth == 0 && i != 0)
+          starts.push_back(i);
+        break;
+      default:
+        break;
+      }
     }
-
-    return new Declaration_syntax({}, id, type, init);
+    return starts;
   }
 
   /// Builds the declarator list.
-  static Syntax* make_declarator_list(Syntax_seq& ts)
+  Syntax* Parser::make_declarator_list(Syntax_seq& ts)
   {
     // TODO: What if `ts` is empty? Recovery means skipping the entire
     // declaration, probably.
@@ -148,579 +240,234 @@ namespace beaker
     return new List_syntax(std::move(ts));
   }
 
-  /// Parse a declarator-list.
-  ///   declarator-list:
-  ///     declarator
-  ///     declartor-list , declarator
-  ///
-  /// Technically, this allows the declaration of multiple functions having
-  /// the same return type, but we can semantically limit declarators to just
-  /// variables.
-  Syntax* Parser::parse_declarator_list()
-  {
-    Syntax_seq ts;
-    parse_item(*this, &Parser::parse_declarator, ts);
-    while (match(Token::comma_tok))
-      parse_item(*this, &Parser::parse_declarator, ts);
-    return make_declarator_list(ts);
-  }
-
-  /// Parse a declarator.
-  ///
-  ///   declarator:
-  ///     postfix-expression
-  Syntax* Parser::parse_declarator()
-  {
-    return parse_postfix_expression();
-  }
-
-  /// Parse a type expression.
-  ///
-  ///   type-expression:
-  ///     prefix-expression
-  Syntax* Parser::parse_type()
-  {
-    return parse_prefix_expression();
-  }
-
-  /// Parse an expression.
-  ///
-  ///   expression:
-  ///     infix-expression
-  ///     return infix-expression
-  ///     yield infix-expression
-  ///     throw infix-expression
-  ///
-  /// TODO: Actually implement throw and yield.
-  Syntax* Parser::parse_expression()
-  {
-    switch (lookahead()) {
-    case Token::return_tok: {
-      Token tok = consume();
-      Syntax* e = parse_infix_expression();
-      return new Prefix_syntax(tok, e);
-    }
-    default:
-      break;
-    }
-    return parse_infix_expression();
-  }
-
-  /// Parse an expression.
-  ///
-  ///   infix-expression:
-  ///     implication-expression
-  Syntax* Parser::parse_infix_expression()
-  {
-    return parse_assignment_expression();
-  }
-
-  /// Parse an assignment.
-  ///
-  ///   assignment-expression:
-  ///     implication-expression
-  ///     implication-expression = assignment-expression
-  Syntax* Parser::parse_assignment_expression()
-  {
-    Syntax* e0 = parse_implication_expression();
-    if (Token op = match(Token::equal_tok)) {
-      Syntax* e1 = parse_assignment_expression();
-      return new Infix_syntax(op, e0, e1);
-    }
-    return e0;
-  }
-
-  /// Parse an implication.
-  ///
-  ///   implication-expression:
-  ///     logical-or-expression
-  ///     logical-or-expression -> implication-expression
-  Syntax* Parser::parse_implication_expression()
-  {
-    Syntax* e0 = parse_logical_or_expression();
-    if (Token op = match(Token::dash_greater_tok)) {
-      Syntax* e1 = parse_implication_expression();
-      return new Infix_syntax(op, e0, e1);
-    }
-    return e0;
-  }
-
-  /// Parse an logical or.
-  ///
-  ///   logical-or-expression:
-  ///     logical-and-expression
-  ///     logical-or-expression or logical-and-expression
-  Syntax* Parser::parse_logical_or_expression()
-  {
-    Syntax* e0 = parse_logical_and_expression();
-    while (Token op = match(Token::or_tok)) {
-      Syntax* e1 = parse_logical_and_expression();
-      e0 = new Infix_syntax(op, e0, e1);
-    }
-    return e0;
-  }
-
-  /// Parse an logical and.
-  ///
-  ///   logical-and-expression:
-  ///     equality-expression
-  ///     logical-and-expression and equality-expression
-  Syntax* Parser::parse_logical_and_expression()
+  /// Returns a list defining the group.
+  Syntax* Parser::make_group(Syntax_seq& ts)
   {
-    Syntax* e0 = parse_equality_expression();
-    while (Token op = match(Token::and_tok)) {
-      Syntax* e1 = parse_equality_expression();
-      e0 = new Infix_syntax(op, e0, e1);
-    }
-    return e0;
-  }
+    // This only happens when there's an error and we can't accumulate
+    // a group. If we propagate errors, this shouldn't happen at all.
+    if (ts.empty())
+      return nullptr;    
 
-  static bool is_equality_operator(Token::Kind k)
-  {
-    return k == Token::equal_equal_tok ||
-           k == Token::bang_equal_tok;
-  }
+    // Don't allocate groups if there's only one present.    
+    if (ts.size() == 1)
+      return ts[0];
 
-  /// Parse an equality comparison.
-  ///
-  ///   equality-expression:
-  ///     relational-expression
-  ///     equality-expression == relational-expression
-  ///     equality-expression != relational-expression
-  Syntax* Parser::parse_equality_expression()
-  {
-    Syntax* e0 = parse_relational_expression();
-    while (Token op = match_if(is_equality_operator)) {
-      Syntax* e1 = parse_relational_expression();
-      e0 = new Infix_syntax(op, e0, e1);
-    }
-    return e0;
+    return new List_syntax(std::move(ts));
   }
 
-  static bool is_relational_operator(Token::Kind k)
+  // Returns a list for `ts`.
+  Syntax* Parser::make_list(Syntax_seq& ts)
   {
-    return k == Token::less_tok ||
-           k == Token::greater_tok ||
-           k == Token::less_equal_tok ||
-           k == Token::greater_equal_tok;
-  }
+    // This only happens when an error occurred.
+    if (ts.empty())
+      return nullptr;
 
-  /// Parse a relational expression.
-  ///
-  ///   relational-expression:
-  ///     additive-expression
-  ///     relational-expression < additive-expression
-  ///     relational-expression > additive-expression
-  ///     relational-expression <= additive-expression
-  ///     relational-expression >= additive-expression
-  Syntax* Parser::parse_relational_expression()
-  {
-    Syntax* e0 = parse_additive_expression();
-    while (Token op = match_if(is_relational_operator)) {
-      Syntax* e1 = parse_additive_expression();
-      e0 = new Infix_syntax(op, e0, e1);
-    }
-    return e0;
+    return new List_syntax(std::move(ts));
   }
 
-  static bool is_additive_operator(Token::Kind k)
+  Parse_memo::Entry* Parse_memo::find(Production p, std::size_t pos, std::size_t depth, bool recovering)
   {
-    return k == Token::plus_tok ||
-           k == Token::dash_tok;
+    if (m_entries.empty())
+      return nullptr;
+    Entry& e = m_entries[(pos * num_productions + (std::size_t)p) % size];
+    if (e.pos == pos && e.prod == p && e.depth == depth && e.recovering == recovering)
+      return &e;
+    return nullptr;
   }
 
-  /// Parse an additive expression.
-  ///
-  ///   additive-expression:
-  ///     multiplicative-expression
-  ///     additive-expression < multiplicative-expression
-  ///     additive-expression > multiplicative-expression
-  Syntax* Parser::parse_additive_expression()
+  void Parse_memo::insert(Entry e)
   {
-    Syntax* e0 = parse_multiplicative_expression();
-    while (Token op = match_if(is_additive_operator)) {
-      Syntax* e1 = parse_multiplicative_expression();
-      e0 = new Infix_syntax(op, e0, e1);
+    if (m_entries.empty())
+      m_entries.resize(size);
+    std::size_t n = (e.pos * num_productions + (std::size_t)e.prod) % size;
+    remove(n);
+    if (e.result) {
+      if (!m_results.empty())
+        remove_nested(e.result);
+      m_results[e.result] = n;
     }
-    return e0;
-  }
-
-  static bool is_multiplicative_operator(Token::Kind k)
-  {
-    return k == Token::star_tok ||
-           k == Token::slash_tok ||
-           k == Token::percent_tok;
+    m_end = std::max(m_end, e.pos + 1);
+    m_entries[n] = std::move(e);
   }
 
-  /// Parse a multiplicative expression.
-  ///
-  ///   multiplicative-expression:
-  ///     prefix-exprssion
-  ///     multiplicative-expression < prefix-exprssion
-  ///     multiplicative-expression > prefix-exprssion
-  Syntax* Parser::parse_multiplicative_expression()
+  void Parse_memo::discard(Syntax* s)
   {
-    Syntax* e0 = parse_prefix_expression();
-    while (Token op = match_if(is_multiplicative_operator)) {
-      Syntax* e1 = parse_prefix_expression();
-      e0 = new Infix_syntax(op, e0, e1);
+    if (!s)
+      return;
+    auto iter = m_results.find(s);
+    if (iter != m_results.end()) {
+      m_entries[iter->second].owned = true;
+      return;
     }
-    return e0;
+    if (!m_results.empty())
+      detach(s);
+    destroy(s);
   }
 
-  /// Parse a prefix-expression.
-  ///
-  ///   prefix-expression:
-  ///     postfix-expression
-  ///     array [ expression-list? ] prefix-expression
-  ///     templ [ expression-group? ] prefix-expression
-  ///     func ( expression-group? ) prefix-expression
-  ///     const prefix-exprssion
-  ///     ^ prefix-expression
-  ///     - prefix-expression
-  ///     + prefix-expression
-  ///     not prefix-expression
-  ///
-  /// NOTE: This is the minimal version of a grammar that both avoids extra
-  /// lookahead and permits expressions and types to occupy the same grammar.
-  /// We could add extra annotations after template and function type
-  /// constructors (e.g., `func(int)->int`), but they aren't strictly necessary.
-  ///
-  /// TODO: The name array is somewhat unfortunate, since it makes a nice
-  /// library structure. If arrays in this (or whatever) language had regular
-  /// semantics, we probably wouldn't need the data type.
-  ///
-  /// Eliminating the leading keyword and adding an annotation before the prefix
-  /// expression also works (e.g., (int)->int), but requires lookahead to
-  /// disambiguate the enclosure from primary expressions. It also means that
-  /// we can't parse implications, unless we had some way of explicitly
-  /// characterizing the leading parameter list as something other than a
-  /// primary expression.
-  Syntax* Parser::parse_prefix_expression()
+  void Parse_memo::clear()
   {
-    switch (lookahead())
-    {
-    case Token::array_tok: {
-      Token tok = consume();
-      Syntax* bound = parse_bracket_list();
-      Syntax* type = parse_prefix_expression();
-      return new Array_syntax(tok, bound, type);
-    }
-
-    case Token::templ_tok: {
-      Token tok = consume();
-      Syntax* parms = parse_bracket_group();
-      Syntax* result = parse_prefix_expression();
-      return new Template_syntax(tok, parms, result);
-    }
-
-    case Token::func_tok: {
-      Token tok = consume();
-      Syntax* parms = parse_paren_group();
-      Syntax* result = parse_prefix_expression();
-      return new Function_syntax(tok, parms, result);
-    }
-
-    case Token::const_tok:
-    case Token::caret_tok:
-    case Token::plus_tok:
-    case Token::dash_tok:
-    case Token::not_tok: {
-      Token op = consume();
-      Syntax* e = parse_prefix_expression();
-      return new Prefix_syntax(op, e);
-    }
-    
-    default:
-      break;
-    }
-    return parse_postfix_expression();
+    for (auto [s, n] : m_results)
+      if (m_entries[n].owned)
+        destroy(m_entries[n].result);
+    m_results.clear();
+    m_entries.clear();
+    m_end = 0;
   }
 
-  /// Parse a postfix-expression.
-  ///
-  ///   postfix-expression:
-  ///     primary-expression
-  ///     postfix-expression ( expression-list? )
-  ///     postfix-expression [ expression-list? ]
-  ///     postfix-expression . id-expression
-  ///     postfix-expression ^
-  Syntax* Parser::parse_postfix_expression()
+  /// Detaches the memoized results in `s` from their parents. The cache
+  /// owns them until they are replayed.
+  void Parse_memo::detach(Syntax* s)
   {
-    Syntax* e0 = parse_primary_expression();
-    while (true)
-    {
-      if (next_token_is(Token::lparen_tok)) {
-        Syntax* args = parse_paren_list();
-        e0 = new Call_syntax(e0, args);
+    for (Syntax*& c : s->children()) {
+      if (!c)
+        continue;
+      auto iter = m_results.find(c);
+      if (iter != m_results.end()) {
+        m_entries[iter->second].owned = true;
+        c = nullptr;
       }
-      else if (next_token_is(Token::lbracket_tok)) {
-        Syntax* args = parse_bracket_list();
-        e0 = new Call_syntax(e0, args);
+      else {
+        detach(c);
       }
-      else if (Token dot = match(Token::dot_tok)) {
-        Syntax* member = parse_id_expression();
-        e0 = new Infix_syntax(dot, e0, member);
-      }
-      else if (Token op = match(Token::caret_tok)) {
-        e0 = new Postfix_syntax(op, e0);
-      }        
-      else
-        break;
     }
-    return e0;
   }
 
-  /// Parse a primary expression.
-  ///
-  ///   primary-expression:
-  ///     literal
-  ///     id-expression
-  ///     ( expression-list? )
-  Syntax* Parser::parse_primary_expression()
+  /// Removes the entries for memoized results in `s`. The walk stops at
+  /// each one, since the results nested in it were removed when it was
+  /// memoized.
+  void Parse_memo::remove_nested(Syntax* s)
   {
-    switch (lookahead()) {
-      // Value literals
-    case Token::true_tok:
-    case Token::false_tok:
-    case Token::integer_tok:
-    // Type literals
-    case Token::int_tok:
-    case Token::bool_tok:
-    case Token::type_tok: {
-      Token value = consume();
-      return new Literal_syntax(value);
+    auto iter = m_results.find(s);
+    if (iter != m_results.end()) {
+      remove(iter->second);
+      return;
     }
-
-    case Token::identifier_tok:
-      return parse_id_expression();
-
-    case Token::lparen_tok:
-      return parse_paren_list();
-    
-    case Token::lbrace_tok:
-      return parse_brace_list();
-
-    default:
-      break;
+    for (Syntax* c : s->children())
+      if (c)
+        remove_nested(c);
+  }
+
+  /// Removes the entry in the slot `n`, if any, destroying its result if
+  /// the cache owns it.
+  void Parse_memo::remove(std::size_t n)
+  {
+    Entry& e = m_entries[n];
+    if (e.pos == std::size_t(-1))
+      return;
+    if (e.result) {
+      m_results.erase(e.result);
+      if (e.owned)
+        destroy(e.result);
     }
-
-    // FIXME: Return an error tree. Also, how can we recover from this?
-    // It might depend on what we're parsing (declarator, type, initialzer,
-    // etc.). To do that, we'd have to maintain a stack of recovery strategies
-    // that we can use to skip tokens.
-    diagnose_expected("primary-expression");
-    return nullptr;
-  }
-
-  /// Parse an id-expression
-  ///
-  ///   id-expression:
-  ///     identifier
-  Syntax* Parser::parse_id_expression()
-  {
-    Token id = expect(Token::identifier_tok);
-    return new Identifier_syntax(id);
-  }
-
-  /// Parse a paren-enclosed group.
-  ///
-  ///   paren-group:
-  ///     ( expression-group? )
-  Syntax* Parser::parse_paren_group()
-  {
-    return parse_enclosed<Enclosure::parens>(&Parser::parse_expression_group);
-  }
-
-  /// Parse a paren-enclosed list.
-  ///
-  ///   paren-list:
-  ///     ( expression-list? )
-  Syntax* Parser::parse_paren_list()
-  {
-    return parse_enclosed<Enclosure::parens>(&Parser::parse_expression_list);
-  }
-
-  /// Parse a bracket-enclosed group.
-  ///
-  ///   bracket-group:
-  ///     [ expression-group? ]
-  Syntax* Parser::parse_bracket_group()
-  {
-    return parse_enclosed<Enclosure::brackets>(&Parser::parse_expression_group);
-  }
-
-  /// Parse a bracket-enclosed list.
-  ///
-  ///   bracket-list:
-  ///     [ expression-list? ]
-  Syntax* Parser::parse_bracket_list()
-  {
-    return parse_enclosed<Enclosure::brackets>(&Parser::parse_expression_list);
-  }
-
-  /// Returns a list defining the group.
-  static Syntax* make_group(Syntax_seq& ts)
-  {
-    // This only happens when there's an error and we can't accumulate
-    // a group. If we propagate errors, this shouldn't happen at all.
-    if (ts.empty())
-      return nullptr;    
-
-    // Don't allocate groups if there's only one present.    
-    if (ts.size() == 1)
-      return ts[0];
-
-    return new List_syntax(std::move(ts));
-  }
-
-  /// Parse an expression-group.
-  ///
-  ///   expression-group:
-  ///     expression-list
-  ///     expression-group ; expression-list
-  ///
-  /// Groups are only created if multiple groups are present.
-  Syntax* Parser::parse_expression_group()
-  {
-    Syntax_seq ts;
-    parse_item(*this, &Parser::parse_expression_list, ts);
-    while (match(Token::semicolon_tok))
-      parse_item(*this, &Parser::parse_expression_list, ts);
-    return make_group(ts);
-  }
-
-  // Returns a list for `ts`.
-  static Syntax* make_list(Syntax_seq& ts)
-  {
-    // This only happens when an error occurred.
-    if (ts.empty())
-      return nullptr;
-
-    return new List_syntax(std::move(ts));
-  }
-
-  /// Parse an expression-list.
-  ///
-  ///   expression-list:
-  ///     parameter-expression
-  ///     expression-list , parameter-expression
-  ///
-  /// This always returns a list, even if there's a single element.
-  Syntax* Parser::parse_expression_list()
-  {
-    Syntax_seq ts;
-    parse_item(*this, &Parser::parse_parameter_or_expression, ts);
-    while (match(Token::comma_tok))
-      parse_item(*this, &Parser::parse_parameter_or_expression, ts);
-    return make_list(ts);
+    e.pos = -1;
+    e.diags.clear();
   }
 
   /// Returns true if `p` starts a parameter declaration.
-  static bool starts_parameter(Parser& p)
+  bool Parser::starts_parameter(Parser& p)
   {
     return p.next_token_is(Token::colon_tok) ||
            p.next_tokens_are(Token::identifier_tok, Token::colon_tok);
   }
 
-  /// Parse a parameter or expression.
-  ///
-  ///   parameter-expression:
-  ///     parameter
-  ///     expression
-  Syntax* Parser::parse_parameter_or_expression()
+  void Parser::diagnose_expected(char const* what)
   {
-    if (starts_parameter(*this))
-      return parse_parameter();
-    return parse_expression();
-  }
+    if (m_recovering)
+      return;
+    m_recovering = true;
 
-  /// Parse a brace-enclosed list.
-  ///
-  ///   brace-list:
-  ///     { statement-seq }
-  Syntax* Parser::parse_brace_list()
-  {
-    return parse_enclosed<Enclosure::braces>(&Parser::parse_statement_seq);
+    std::stringstream ss;
+    ss << "expected '" << what << "' but got ";
+    if (eof())
+      ss << "end of file";
+    else
+      ss << "'" << peek().spelling() << "'";
+    m_diags->error(input_location(), ss.str());
   }
 
-  /// Parse a statement sequence.
-  Syntax* Parser::parse_statement_seq()
+  void Parser::diagnose_expected(Token::Kind k)
   {
-    // Parse a statement and increment the count. This is used to allow
-    // the omission of the a trailing semicolon on first statements.
-    std::size_t num = 0;
-    auto parse = [this, &num]() {
-      return parse_statement(num++);
-    };
-
-    Syntax_seq ts;
-    parse_item(parse, ts);
-    while (next_token_is_not(Token::rbrace_tok))
-      parse_item(parse, ts);
-
-    return make_declarator_list(ts);
+    diagnose_expected(Token::spelling(k));
   }
 
-  /// Parse a statement.
-  ///
-  ///   statement:
-  ///     declaration-statement
-  ///     return-statement
-  ///     expression-statement
-  Syntax* Parser::parse_statement(std::size_t n)
+  /// Returns true if `k` can end or separate terms. These are not consumed
+  /// by errors so that the enclosing construct can match them.
+  static bool is_synchronizing(Token::Kind k)
   {
-    switch (lookahead()) {
+    switch (k) {
+    case Token::eof_tok:
+    case Token::semicolon_tok:
+    case Token::comma_tok:
+    case Token::colon_tok:
+    case Token::rparen_tok:
+    case Token::rbracket_tok:
+    case Token::rbrace_tok:
     case Token::def_tok:
-      return parse_declaration_statement(n);
+      return true;
     default:
-      break;
+      return false;
     }
-    return parse_expression_statement(n);
-  }
-
-  /// Parse a declaration-statement.
-  ///
-  ///   declaration-statement:
-  ///     declaration
-  ///
-  /// Not all declarations are allowed in all scopes. However, we don't
-  /// really have a notion of scope attached to the parse, so we have to
-  /// filter semantically.
-  Syntax* Parser::parse_declaration_statement(std::size_t n)
-  {
-    return parse_declaration();
   }
 
-  /// Parse an expression-statement.
-  ///
-  ///   expression-statement:
-  ///     expression-list ;?
-  ///
-  /// The semicolon is required this is the first statement in a brace-list
-  /// and the next token is `}`. That allows for brace-lists of the form
-  /// `{ a, b, c }`.
-  Syntax* Parser::parse_expression_statement(std::size_t n)
-  {
-    Syntax* e = parse_expression_list();
-    if (n == 0 && next_token_is(Token::rbrace_tok))
-      return e;
-    expect(Token::semicolon_tok);
-    return e;
-  }
-
-  void Parser::diagnose_expected(char const* what)
+  /// Diagnoses a missing `what`, returning an error node. The offending token
+  /// is consumed unless it might be matched by an enclosing construct.
+  Syntax* Parser::parse_error(char const* what)
   {
-    std::stringstream ss;
-    ss << input_location() << ": "
-       << "expected '" << what 
-       << "' but got '" << peek().spelling() << "'";
-    throw std::runtime_error(ss.str());
+    Token tok = peek();
+    diagnose_expected(what);
+    if (!is_synchronizing(tok.kind()))
+      consume();
+    return new Error_syntax(tok);
   }
 
-  void Parser::diagnose_expected(Token::Kind k)
+  /// Diagnoses nesting deeper than the maximum depth, returning an error
+  /// node. The rest of the term is skipped, without descending into any
+  /// brackets it contains.
+  Syntax* Parser::parse_too_deep()
   {
-    diagnose_expected(Token::spelling(k));
+    Token tok = peek();
+    if (!m_recovering) {
+      m_recovering = true;
+      std::stringstream ss;
+      ss << "nesting exceeds the maximum depth of " << m_max_depth;
+      m_diags->error(input_location(), ss.str());
+    }
+    while (!is_synchronizing(lookahead()))
+      skip_group();
+    return new Error_syntax(tok);
+  }
+
+  /// Skips the current token. If that's an opening bracket, skip through its
+  /// matching bracket, if it has one.
+  void Parser::skip_group()
+  {
+    assert(!eof());
+    std::size_t n = m_matches[m_pos];
+    if (n != m_toks.size() && n > m_pos)
+      m_pos = n + 1;
+    else
+      ++m_pos;
+  }
+
+  /// Skips to the end of the current statement or declaration. This stops
+  /// after the next `;`, or before a `}`, `def`, or the end of file.
+  void Parser::recover()
+  {
+    while (!eof()) {
+      switch (lookahead()) {
+      case Token::semicolon_tok:
+        consume();
+        m_recovering = false;
+        return;
+      case Token::rbrace_tok:
+      case Token::def_tok:
+        m_recovering = false;
+        return;
+      default:
+        skip_group();
+        break;
+      }
+    }
   }
 
   void Parser::debug(char const* msg)
@@ -5,21 +5,298 @@
 #include <beaker/frontend/lexer.hpp>
 #include <beaker/frontend/token.hpp>
 #include <beaker/frontend/syntax.hpp>
+#include <beaker/frontend/parse_profile.hpp>
 
 #include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace beaker
 {
   struct Syntax;
 
+  /// The associativity of infix operators.
+  enum class Associativity
+  {
+    left,
+    right,
+  };
+
+  /// The precedence of infix operators, from loosest to tightest binding.
+  enum Precedence : int
+  {
+    no_precedence,
+    assignment_precedence,
+    implication_precedence,
+    logical_or_precedence,
+    logical_and_precedence,
+    equality_precedence,
+    relational_precedence,
+    additive_precedence,
+    multiplicative_precedence,
+  };
+
+  /// The binding of a token as an infix operator. Tokens that are not infix
+  /// operators have no precedence.
+  struct Infix_operator
+  {
+    Precedence precedence = no_precedence;
+    Associativity associativity = Associativity::left;
+  };
+
+  /// Maps tokens to their binding as infix operators. Each language variant
+  /// adjusts the entries of this table to define its infix grammar.
+  struct Infix_table
+  {
+    /// Returns the binding of `k`.
+    Infix_operator operator[](Token::Kind k) const
+    {
+      return m_ops[k];
+    }
+
+    /// Makes `k` an infix operator with the given binding.
+    void set(Token::Kind k, Precedence p, Associativity a = Associativity::left)
+    {
+      m_ops[k] = {p, a};
+    }
+
+    /// Makes `k` not an infix operator.
+    void clear(Token::Kind k)
+    {
+      m_ops[k] = {};
+    }
+
+    /// Makes no token an infix operator.
+    void clear()
+    {
+      for (Infix_operator& op : m_ops)
+        op = {};
+    }
+
+    Infix_operator m_ops[num_token_kinds];
+  };
+
+  /// Productions whose parses are memoized by `Parser::speculate`.
+  enum class Production
+  {
+    function_type,
+    paren_list,
+  };
+
+  constexpr std::size_t num_productions = (std::size_t)Production::paren_list + 1;
+
+  /// A bounded cache of parses, indexed by production, starting token, and
+  /// nesting depth.
+  ///
+  /// The cache is direct-mapped: each production and position has a single
+  /// slot, and a new entry replaces the one in its slot. Entries for tokens
+  /// within `size / num_productions` of each other never replace one another,
+  /// so backtracking over fewer tokens than that takes linear time.
+  ///
+  /// A replayed result is the tree made by the first parse, so the partial
+  /// tree of a failed speculation must be passed to `discard`. That destroys
+  /// it, except for the memoized results in it, which the cache owns until
+  /// they are replayed or their entries are removed. Entries for results
+  /// nested in a newly memoized one are removed, so a result is never
+  /// replayed while it is part of another.
+  struct Parse_memo
+  {
+    static constexpr std::size_t size = 4096;
+
+    /// The result of parsing a production at a token.
+    struct Entry
+    {
+      Production prod;
+      std::size_t pos = -1;
+      std::size_t depth; // The nesting depth before the parse.
+      bool recovering; // The recovery state before the parse.
+      Syntax* result; // Null if the parse failed.
+      std::size_t end;
+      bool end_recovering; // The recovery state after the parse.
+      bool owned; // True if the result is in no tree.
+      std::vector<Diagnostic> diags;
+    };
+
+    Parse_memo() = default;
+
+    // Copies of a parser start with an empty cache.
+    Parse_memo(Parse_memo const&)
+    { }
+
+    Parse_memo& operator=(Parse_memo const&) = delete;
+
+    ~Parse_memo()
+    {
+      clear();
+    }
+
+    /// Returns the entry for `p` at `pos`, or null if there is none.
+    Entry* find(Production p, std::size_t pos, std::size_t depth, bool recovering);
+
+    /// Adds the entry `e`, replacing the one in its slot.
+    void insert(Entry e);
+
+    /// Destroys `s`, the partial tree of a failed speculation, except for
+    /// the memoized results in it.
+    void discard(Syntax* s);
+
+    /// Removes all entries, destroying the results that the cache owns.
+    void clear();
+
+    /// Returns true if a parse at the token `pos` may be replayed.
+    bool covers(std::size_t pos) const
+    {
+      return pos < m_end;
+    }
+
+    void detach(Syntax* s);
+    void remove_nested(Syntax* s);
+    void remove(std::size_t n);
+
+    // Allocated on first use.
+    std::vector<Entry> m_entries;
+
+    // The slot of the entry for each memoized result.
+    std::unordered_map<Syntax const*, std::size_t> m_results;
+
+    // One past the last token at which a parse is memoized.
+    std::size_t m_end = 0;
+
+    // The number of parses made while memoizing, and the number replayed.
+    std::size_t m_parses = 0;
+    std::size_t m_replays = 0;
+  };
+
+  /// The tokens of a source file and the table of their matching brackets.
+  /// This is shared by copies of a parser (e.g., the workers of a parallel
+  /// parse).
+  struct Token_stream
+  {
+    std::vector<Token> toks;
+    std::vector<std::size_t> matches;
+    Token eof;
+  };
+
+  /// The tokens of a file that is parsed one top-level declaration at a time.
+  /// Tokens are lexed as they are needed and released after they are parsed.
+  struct Token_source
+  {
+    Token_source(Translation& trans, std::filesystem::path const& p, std::istream& is)
+      : lex(trans, p, is)
+    { }
+
+    /// Lexes the next token. Returns false at the end of file.
+    bool get();
+
+    Lexer lex;
+
+    // The unreleased tokens, and the positions of those that start
+    // declarations: `def` tokens not enclosed by any bracket.
+    std::vector<Token> toks;
+    std::vector<std::size_t> starts;
+
+    // The numbers of unclosed parens, brackets, and braces.
+    std::size_t depth[3] = {};
+
+    // The end-of-file token, once lexed.
+    Token eof;
+    bool done = false;
+  };
+
   /// Constructs a concrete syntax tree from a source file. This is the
-  /// base class of experimental language parsers. The "main" entry point
-  /// to various syntactic forms are defined as virtual functions to be
-  /// overridden for various experiments.
+  /// base class of experimental language parsers. It holds the state of
+  /// the parse and the operations on tokens. The grammar is defined by
+  /// `Basic_parser`, and `parse_file` is the entry point for users that
+  /// don't know which language they are parsing.
   struct Parser
   {
     Parser(Translation& trans, std::filesystem::path const& p);
 
+    /// Parses `text` as the contents of the file `p`.
+    Parser(Translation& trans, std::filesystem::path const& p, std::string text);
+
+    /// Parses the file `p` from `is` one top-level declaration at a time.
+    /// See `parse_next`.
+    Parser(Translation& trans, std::filesystem::path const& p, std::istream& is);
+
+    virtual ~Parser() = default;
+
+    /// Parses `text` as the contents of the file `p` from now on, reusing
+    /// the storage of the previous tokens unless they are shared (e.g., by
+    /// the deferred bodies of previously parsed trees).
+    void reset(std::filesystem::path const& p, std::string_view text);
+
+    /// Parses the entire file.
+    virtual Syntax* parse_file() = 0;
+
+    /// Parses and returns the next top-level declaration, or null at the
+    /// end of file.
+    ///
+    /// When parsing from a stream, only the tokens of that declaration and
+    /// a few following tokens are in memory, and the tokens are released
+    /// when the next declaration is parsed. The declaration is parsed exactly
+    /// as `parse_file` would parse it. Definition bodies are never deferred,
+    /// since the tokens behind them are released. The caller owns the
+    /// declaration, and can `destroy` it before parsing the next one.
+    virtual Syntax* parse_next() = 0;
+
+    /// Parses the file `p` from `is` instead of the current tokens. This
+    /// supports the stream constructors of derived parsers.
+    void set_input(std::filesystem::path const& p, std::istream& is);
+
+    /// Parses the entire file, reusing the unchanged top-level declarations
+    /// of `old`, which was parsed from the tokens `prev`. Reused subtrees
+    /// are moved into the new tree, and their locations are updated. The
+    /// rest of `old` is destroyed, so the caller must not use it again.
+    /// Only the reparsed declarations are diagnosed.
+    virtual Syntax* reparse(Syntax* old, Token_stream const& prev) = 0;
+
+    /// Returns the tokens of the file.
+    std::shared_ptr<Token_stream const> tokens() const
+    {
+      return m_stream;
+    }
+
+    /// Parses the body of a deferred brace-list starting at the token `pos`.
+    /// Returns the inner term of the list.
+    virtual Syntax* parse_deferred(std::size_t pos) = 0;
+
+    /// Returns the parser of the bodies deferred while parsing the current
+    /// tokens, creating it if needed. This is a copy of the root parser,
+    /// shared by the nodes that defer bodies, so bodies can be parsed after
+    /// this parser is reset or destroyed. It is not created concurrently,
+    /// so it must exist before workers parse in parallel.
+    std::shared_ptr<Parser> const& body_parser();
+
+    /// Returns a copy of this parser.
+    virtual std::shared_ptr<Parser> copy() const = 0;
+
+    /// Sets the number of jobs used to parse top-level declarations. Zero
+    /// uses one job per hardware thread.
+    void set_jobs(std::size_t n)
+    {
+      m_jobs = n;
+    }
+
+    /// Sets the maximum depth of nested brackets and prefix operators.
+    void set_max_depth(std::size_t n)
+    {
+      m_max_depth = n;
+    }
+
+    /// The default maximum depth of nesting.
+    static constexpr std::size_t default_max_depth = 256;
+
+    /// When `b` is true, brace-list initializers of definitions are skipped
+    /// and parsed when they are first accessed. See `Deferred_syntax`.
+    void set_lazy(bool b)
+    {
+      m_lazy = b;
+    }
+
     // Token operations
 
     /// Returns true if we're at the end of file.
@@ -38,16 +315,53 @@ namespace beaker
     {
       if (m_pos < m_toks.size())
         return m_toks[m_pos];
-      return {};
+      return m_eof;
     }
 
     /// Peeks at the nth token past the current token.
     Token peek(int n) const
     {
+      note_lookahead(n);
       if (m_pos + n < m_toks.size())
         return m_toks[m_pos + n];
-      return {};
+      return m_eof;
+    }
+
+    /// Returns the lookahead distance to the bracket matching the current
+    /// token, which must be an opening bracket. If there is no matching
+    /// bracket, this is the distance to the end of file.
+    std::size_t find_matching() const
+    {
+      assert(m_pos < m_toks.size());
+      note_lookahead(m_matches[m_pos] - m_pos);
+      return m_matches[m_pos] - m_pos;
+    }
+
+    /// Records that the parser examined the token `n` past the current one
+    /// to decide how to parse the current one.
+    void note_lookahead(std::size_t n) const
+    {
+      if (n > m_max_lookahead)
+        m_max_lookahead = n;
+#ifdef BEAKER_PARSER_PROFILE
+      m_profile.note_lookahead(n);
+#endif
+    }
+
+    /// Returns the largest lookahead distance used so far, including the
+    /// tokens consumed by failed speculative parses.
+    std::size_t max_lookahead() const
+    {
+      return m_max_lookahead;
+    }
+
+#ifdef BEAKER_PARSER_PROFILE
+    /// Returns the costs of each production parsed so far.
+    Parse_profile const& profile() const
+    {
+      return m_profile;
     }
+#endif
 
     /// Returns the kind of the current token.
     Token::Kind lookahead() const
@@ -112,12 +426,13 @@ namespace beaker
     }
 
     /// Consume the next token if it has kind `k`, otherwise emit a diagnostic.
+    /// On error, this returns an empty token at the current location.
     Token expect(Token::Kind k)
     {
       if (next_token_is(k))
         return consume();
       diagnose_expected(k);
-      return {};
+      return Token(Token::eof_tok, {}, input_location());
     }
 
     /// Returns the current token, ensuring that it has kind `k`.
@@ -127,66 +442,9 @@ namespace beaker
       return consume();
     }
 
-    // Parsing
-
-    // Top-level.
-    virtual Syntax* parse_file();
-
-    // Declarations.
-    virtual Syntax* parse_declaration();
-    Syntax* parse_definition();
-    Syntax* parse_parameter();
-    Syntax* parse_declaration_seq();
-
-    // Declarators.
-    virtual Syntax* parse_declarator();
-    Syntax* parse_declarator_list();
-
-    // Types.
-    virtual Syntax* parse_type();
-
-    // Expressions, in general.
-    virtual Syntax* parse_expression();
-    
-    // Infix expressions.
-    virtual Syntax* parse_infix_expression();
-    virtual Syntax* parse_assignment_expression();
-    virtual Syntax* parse_implication_expression();
-    Syntax* parse_logical_or_expression();
-    Syntax* parse_logical_and_expression();
-    Syntax* parse_equality_expression();
-    Syntax* parse_relational_expression();
-    Syntax* parse_additive_expression();
-    Syntax* parse_multiplicative_expression();
-    
-    // Prefix expressions.
-    virtual Syntax* parse_prefix_expression();
-    
-    // Postfix expressions.
-    virtual Syntax* parse_postfix_expression();
-    
-    // Primary expressions.
-    virtual Syntax* parse_primary_expression();
-    Syntax* parse_tuple_expression();
-    Syntax* parse_list_expression();
-    Syntax* parse_id_expression();
-
-    // Helper grammars
-    Syntax* parse_paren_list();
-    Syntax* parse_paren_group();
-    Syntax* parse_bracket_list();
-    Syntax* parse_bracket_group();
-    Syntax* parse_expression_group();
-    Syntax* parse_expression_list();
-    Syntax* parse_brace_list();
-
-    // Statements
-    virtual Syntax* parse_statement(std::size_t n);
-    Syntax* parse_declaration_statement(std::size_t n);
-    Syntax* parse_expression_statement(std::size_t n);
-    Syntax* parse_statement_seq();
-
-    Syntax* parse_parameter_or_expression();
+    /// Returns the positions of tokens that likely start top-level
+    /// declarations.
+    std::vector<std::size_t> find_declarations() const;
 
     // Generic parsers and utilities
 
@@ -245,32 +503,174 @@ namespace beaker
       return enclosing_toks[(int)e].close;
     }
 
-    /// Parse a list enclosed by the tokens of E. Note that a list
-    /// is comprised of groups, so that's allowed.
-    template<Enclosure E, typename F>
-    Syntax* parse_enclosed(F fn)
+    // Speculative parsing
+    //
+    // A grammar with alternatives that can't be told apart by a bounded
+    // lookahead tries one and backtracks if it fails. Parses made while
+    // speculating are memoized, so retrying one after backtracking takes
+    // constant time, and parsing with backtracking takes linear time.
+
+    /// Parses the production `p` at the current token by calling `fn`, which
+    /// returns null if the tokens don't match, after passing anything it
+    /// parsed to `discard`. On failure, the position and recovery state are
+    /// restored, diagnostics issued during the parse are discarded, and this
+    /// returns null.
+    template<typename F>
+    Syntax* speculate(Production p, F fn)
+    {
+      if (Parse_memo::Entry* e = m_memo.find(p, m_pos, m_depth, m_recovering)) {
+        m_pos = e->end;
+        m_recovering = e->end_recovering;
+        for (Diagnostic const& diag : e->diags)
+          m_diags->error(diag.location, diag.message);
+        e->owned = false;
+        ++m_memo.m_replays;
+        return e->result;
+      }
+      ++m_memo.m_parses;
+
+      std::size_t pos = m_pos;
+      bool recovering = m_recovering;
+      Diagnostic_sink diags;
+      Diagnostic_sink* outer = m_diags;
+      m_diags = &diags;
+      ++m_speculating;
+      Syntax* s = fn();
+      --m_speculating;
+      m_diags = outer;
+      if (!s) {
+        note_lookahead(m_pos - pos);
+        m_pos = pos;
+        m_recovering = recovering;
+        diags.m_diags.clear();
+      }
+
+      // Only a parse made while speculating can be retried, after the
+      // enclosing speculation fails.
+      if (m_speculating != 0)
+        m_memo.insert({p, pos, m_depth, recovering, s, m_pos, m_recovering, false, diags.m_diags});
+
+      for (Diagnostic const& diag : diags.diagnostics())
+        m_diags->error(diag.location, diag.message);
+      return s;
+    }
+
+    /// Returns true if a parse at the current token may be memoized or
+    /// replayed: while speculating, or after backtracking to before a
+    /// memoized parse. Otherwise, productions that are only memoized for
+    /// retries are parsed directly. The memo is cleared once the parser
+    /// has moved past its entries.
+    bool memoizing()
+    {
+      if (m_speculating != 0 || m_memo.covers(m_pos))
+        return true;
+      if (m_memo.m_end != 0)
+        m_memo.clear();
+      return false;
+    }
+
+    /// Destroys `s`, parsed by a speculation that failed. Memoized parses
+    /// in it are kept for replay.
+    void discard(Syntax* s)
+    {
+      m_memo.discard(s);
+    }
+
+    // Nesting
+    //
+    // Nested brackets and chains of prefix operators are parsed recursively.
+    // Their depth is limited so that deeply nested input is diagnosed
+    // instead of overflowing the stack.
+
+    /// Parses a term nested in the current one by calling `fn`. If that
+    /// exceeds the maximum depth, the rest of the current term is skipped
+    /// and an error is returned.
+    template<typename F>
+    Syntax* nested(F fn)
     {
-      Token open = require(open_token(E));
-      Syntax* t = nullptr;
-      if (next_token_is_not(close_token(E)))
-        t = (this->*fn)();
-      Token close = expect(close_token(E));
-      return new Enclosure_syntax(open, close, t);
+      if (m_depth == m_max_depth)
+        return parse_too_deep();
+      ++m_depth;
+      Syntax* s = fn();
+      --m_depth;
+      return s;
     }
 
-    // Diagnostics
+    Syntax* parse_too_deep();
+
+    // Builders for lists of terms.
+    static Syntax* make_declarator_list(Syntax_seq& ts);
+    static Syntax* make_group(Syntax_seq& ts);
+    static Syntax* make_list(Syntax_seq& ts);
+
+    static bool starts_parameter(Parser& p);
+
+    // Diagnostics and recovery
+    //
+    // Errors are reported to the translation's diagnostics, and parsing
+    // continues. After an error, further errors are suppressed until the
+    // parser recovers at the next statement or declaration.
 
     void diagnose_expected(char const* what);
     void diagnose_expected(Token::Kind k);
 
+    Syntax* parse_error(char const* what);
+    void recover();
+    void skip_group();
+
+    void lex_tokens();
+
+    // Streaming
+
+    void release_tokens();
+    void extend_tokens(std::size_t n);
+
     // Debugging
 
     void debug(char const* msg);
 
     Translation& m_trans;
-    Lexer m_lex;
-    std::vector<Token> m_toks;
+
+    // The lexer and bracket matcher are kept to lex new text on `reset`.
+    std::shared_ptr<Lexer> m_lexer;
+    Bracket_matcher m_matcher;
+
+    std::shared_ptr<Token_stream const> m_stream;
+    std::span<Token const> m_toks;
+    std::span<std::size_t const> m_matches;
+    Token m_eof;
     std::size_t m_pos;
+    mutable std::size_t m_max_lookahead = 0;
+    Infix_table m_infix;
+    Diagnostic_sink* m_diags;
+    bool m_recovering = false;
+    std::size_t m_jobs = 1;
+    bool m_lazy = false;
+
+    // Memoized parses, and the depth of nested speculative parses.
+    Parse_memo m_memo;
+    std::size_t m_speculating = 0;
+
+    // The current and maximum depth of nesting.
+    std::size_t m_depth = 0;
+    std::size_t m_max_depth = default_max_depth;
+
+    // The parser that owns the tokens. Copies of a parser (e.g., parallel
+    // workers) share the root, whose body parser parses deferred bodies.
+    Parser* m_root = this;
+    std::shared_ptr<Parser> m_bodies;
+
+    // The source of tokens when parsing a stream, which is shared by copies
+    // of the parser. The current tokens are a window of the source, which
+    // ends a few tokens after `m_limit`, the start of the next declaration.
+    std::shared_ptr<Token_source> m_source;
+    std::size_t m_limit = 0;
+
+#ifdef BEAKER_PARSER_PROFILE
+    // The costs of each production. Lookahead is recorded by const
+    // functions.
+    mutable Parse_profile m_profile;
+#endif
   };
 
 } // namespace beaker
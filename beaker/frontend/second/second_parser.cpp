@@ -7,50 +7,31 @@
 
 namespace beaker
 {
-  /// Parse an infix expression.
+  /// The infix grammar of this language is:
   ///
   ///   infix-expression:
   ///     logic-or-expression
   ///
   /// This language does not permit `->` as an infix operator because it
-  /// is used as a suffix for function types in prefix-expressions.
-  Syntax* Second_parser::parse_infix_expression()
-  {
-    return parse_logical_or_expression();
-  }
+  /// is used as a suffix for function types in prefix-expressions. There
+  /// is no assignment operator either.
+  Second_parser::Second_parser(Translation& trans, std::filesystem::path const& p)
+    : Second_parser(trans, p, read_file(p))
+  { }
 
-  /// Find the matching offset of the current token.
-  static std::size_t find_matching(Parser& p, Token::Kind k1, Token::Kind k2)
+  Second_parser::Second_parser(Translation& trans, std::filesystem::path const& p, std::string text)
+    : Basic_parser(trans, p, std::move(text))
   {
-    assert(p.lookahead() == k1);
-    std::size_t braces = 0;
-    std::size_t la = 0;
-    while (Token::Kind k = p.lookahead(la)) {
-      if (k == k1) {
-        ++braces;
-      }
-      else if (k == k2) {
-        --braces;
-        if (braces == 0)
-          break;
-      }
-      ++la;
-    }
-    return la;
+    m_infix.clear(Token::equal_tok);
+    m_infix.clear(Token::dash_greater_tok);
   }
 
-  // Returns true if the sequence of tokens would start a function type.
-  // To determine this, starting at '(', we find the matching ')' and then
-  // look for the trailing `->`.
-  //
-  // TODO: This would be cleaner if the enclosure stuff were in the parser
-  // header.
-  static bool starts_function_type(Parser& p)
+  Second_parser::Second_parser(Translation& trans, std::filesystem::path const& p, std::istream& is)
+    : Second_parser(trans, p, std::string())
   {
-    std::size_t la = find_matching(p, Token::lparen_tok, Token::rparen_tok);
-    return p.lookahead(la + 1) == Token::dash_greater_tok;
+    set_input(p, is);
   }
-  
+
   /// Parse a prefix expression.
   ///
   ///   prefix-expression:
@@ -65,18 +46,20 @@ namespace beaker
   ///     not prefix-expression
   ///
   /// Note that the array notation is unambiguous only because there are no
-  /// primary expressions that start with `[`. For function type constructors,
-  /// we have to brace-match the closing paren and look for the `->`, which
-  /// requires infinite lookahead.
+  /// primary expressions that start with `[`. A function type constructor
+  /// can't be distinguished from a parenthesized expression until the `->`
+  /// after the closing paren, so we try to parse one and backtrack. Parens
+  /// parsed by the attempt are memoized, so they aren't parsed again.
   Syntax* Second_parser::parse_prefix_expression()
   {
+    BEAKER_PROFILE_PRODUCTION();
     switch (lookahead())
     {
     case Token::lbracket_tok: {
       // Match array and template type constructors.
       Syntax* spec = parse_bracket_group();
       Token tok = match(Token::equal_greater_tok);
-      Syntax* type = parse_prefix_expression();
+      Syntax* type = nested([this] { return parse_prefix_expression(); });
       if (tok)
         return new Infix_syntax(tok, spec, type);
       else
@@ -85,12 +68,9 @@ namespace beaker
 
     case Token::lparen_tok: {
       // Match function type constructors.
-      if (!starts_function_type(*this))
-        break;
-      Syntax* parms = parse_paren_group();
-      Token tok = expect(Token::dash_greater_tok);
-      Syntax* result = parse_prefix_expression();
-      return new Infix_syntax(tok, parms, result);
+      if (Syntax* s = speculate(Production::function_type, [this] { return parse_function_type(); }))
+        return s;
+      break;
     }
 
     case Token::const_tok:
@@ -99,7 +79,7 @@ namespace beaker
     case Token::dash_tok:
     case Token::not_tok: {
       Token op = consume();
-      Syntax* e = parse_prefix_expression();
+      Syntax* e = nested([this] { return parse_prefix_expression(); });
       return new Prefix_syntax(op, e);
     }
     
@@ -109,4 +89,24 @@ namespace beaker
     return parse_postfix_expression();
   }
 
+  /// Parse a function type, failing if the parameters are not followed
+  /// by `->`.
+  ///
+  ///   function-type:
+  ///     ( expression-group? ) -> prefix-expression
+  Syntax* Second_parser::parse_function_type()
+  {
+    BEAKER_PROFILE_PRODUCTION();
+    Syntax* parms = parse_paren_group();
+    Token tok = match(Token::dash_greater_tok);
+    if (!tok) {
+      discard(parms);
+      return nullptr;
+    }
+    Syntax* result = nested([this] { return parse_prefix_expression(); });
+    return new Infix_syntax(tok, parms, result);
+  }
+
+  template struct Basic_parser<Second_parser>;
+
 } // namespace beaker
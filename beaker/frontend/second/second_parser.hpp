@@ -1,19 +1,23 @@
 #ifndef BEAKER_FRONTEND_SECOND_PARSER_HPP
 #define BEAKER_FRONTEND_SECOND_PARSER_HPP
 
-#include <beaker/frontend/parser.hpp>
+#include <beaker/frontend/basic_parser.hpp>
 
 namespace beaker
 {
   /// Constructs a concrete syntax tree from a source file.
-  struct Second_parser : Parser
+  struct Second_parser : Basic_parser<Second_parser>
   {
-    using Parser::Parser;
+    Second_parser(Translation& trans, std::filesystem::path const& p);
+    Second_parser(Translation& trans, std::filesystem::path const& p, std::string text);
+    Second_parser(Translation& trans, std::filesystem::path const& p, std::istream& is);
 
-    Syntax* parse_infix_expression() override;
-    Syntax* parse_prefix_expression() override;
+    Syntax* parse_prefix_expression();
+    Syntax* parse_function_type();
   };
 
+  extern template struct Basic_parser<Second_parser>;
+
 } // namespace beaker
 
 #endif
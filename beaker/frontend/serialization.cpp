@@ -0,0 +1,453 @@
+#include <beaker/frontend/serialization.hpp>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace beaker
+{
+  // Node layouts
+  //
+  // The tokens and arity of each node are determined by overload resolution
+  // on the most derived node class, so new kinds in `syntax.def` pick up the
+  // encoding of their bases.
+
+  namespace
+  {
+    std::array<Token, 0> syntax_tokens(Syntax const* s)
+    {
+      return {};
+    }
+
+    std::array<Token, 1> syntax_tokens(Atom_syntax const* s)
+    {
+      return {s->token()};
+    }
+
+    std::array<Token, 2> syntax_tokens(Enclosure_syntax const* s)
+    {
+      return {s->open(), s->close()};
+    }
+
+    std::array<Token, 1> syntax_tokens(Prefix_syntax const* s)
+    {
+      return {s->operation()};
+    }
+
+    std::array<Token, 1> syntax_tokens(Postfix_syntax const* s)
+    {
+      return {s->operation()};
+    }
+
+    std::array<Token, 1> syntax_tokens(Infix_syntax const* s)
+    {
+      return {s->operation()};
+    }
+
+    std::array<Token, 1> syntax_tokens(Constructor_syntax const* s)
+    {
+      return {s->type()};
+    }
+
+    std::array<Token, 1> syntax_tokens(Declaration_syntax const* s)
+    {
+      return {s->introducer()};
+    }
+
+    constexpr std::uint8_t syntax_arity(Syntax const* s)
+    {
+      return 0;
+    }
+
+    constexpr std::uint8_t syntax_arity(Unary_syntax const* s)
+    {
+      return 1;
+    }
+
+    constexpr std::uint8_t syntax_arity(Binary_syntax const* s)
+    {
+      return 2;
+    }
+
+    constexpr std::uint8_t syntax_arity(Ternary_syntax const* s)
+    {
+      return 3;
+    }
+
+    constexpr std::uint8_t syntax_arity(Multiary_syntax const* s)
+    {
+      return archive_variadic;
+    }
+
+    template<typename T>
+    constexpr std::uint8_t token_count()
+    {
+      return std::tuple_size_v<decltype(syntax_tokens(std::declval<T const*>()))>;
+    }
+
+    template<typename T>
+    constexpr Archive_layout layout_of()
+    {
+      static_assert(token_count<T>() <= 2, "too many tokens for Archive_node");
+      return {token_count<T>(), syntax_arity(static_cast<T const*>(nullptr))};
+    }
+
+    // The FNV-1a hash of `str`.
+    constexpr std::uint64_t fnv1a(char const* str)
+    {
+      std::uint64_t h = 0xcbf29ce484222325;
+      for (; *str; ++str) {
+        h ^= std::uint8_t(*str);
+        h *= 0x100000001b3;
+      }
+      return h;
+    }
+
+    // Every node and token definition in declaration order.
+    constexpr char const definitions[] =
+#define def_syntax(T, B) #T ":" #B ";"
+#define def_abstract(T, B) "abstract " #T ":" #B ";"
+#include <beaker/frontend/syntax.def>
+#define def_token(K) #K ";"
+#define def_singleton(K, S) #K "=" S ";"
+#include <beaker/frontend/token.def>
+      ;
+  } // namespace
+
+  std::uint64_t archive_fingerprint()
+  {
+    constexpr std::uint64_t h = fnv1a(definitions);
+    return h;
+  }
+
+  Archive_layout archive_layout(Syntax::Kind k)
+  {
+    switch (k) {
+#define def_syntax(T, B) \
+    case Syntax::T: \
+      return layout_of<T ## _syntax>();
+#include <beaker/frontend/syntax.def>
+    default:
+      break;
+    }
+    assert(false);
+    __builtin_unreachable();
+  }
+
+  // Writing
+
+  namespace
+  {
+    struct Archive_writer
+    {
+      void byte(std::string& out, std::uint8_t b)
+      {
+        out.push_back(b);
+      }
+
+      void u32(std::string& out, std::uint32_t n)
+      {
+        for (int i = 0; i < 4; ++i)
+          out.push_back(std::uint8_t(n >> (i * 8)));
+      }
+
+      void u64(std::string& out, std::uint64_t n)
+      {
+        for (int i = 0; i < 8; ++i)
+          out.push_back(std::uint8_t(n >> (i * 8)));
+      }
+
+      void varint(std::string& out, std::uint64_t n)
+      {
+        while (n >= 0x80) {
+          out.push_back(std::uint8_t(n | 0x80));
+          n >>= 7;
+        }
+        out.push_back(std::uint8_t(n));
+      }
+
+      // Returns the index of `sym`, adding it to the symbol table if needed.
+      std::uint32_t symbol(Symbol sym)
+      {
+        auto result = m_indexes.emplace(sym.m_str, m_syms.size());
+        if (result.second)
+          m_syms.push_back(sym);
+        return result.first->second;
+      }
+
+      void token(Token tok)
+      {
+        byte(m_nodes, tok.kind());
+        if (!tok.is_eof())
+          varint(m_nodes, symbol(tok.symbol()));
+        varint(m_nodes, tok.start_location().line);
+        varint(m_nodes, tok.start_location().column);
+      }
+
+      template<typename T>
+      void tokens(T const* s)
+      {
+        for (Token tok : syntax_tokens(s))
+          token(tok);
+      }
+
+      void node(Syntax const* s)
+      {
+        if (!s) {
+          byte(m_nodes, archive_null);
+          return;
+        }
+
+        byte(m_nodes, s->kind());
+        switch (s->kind()) {
+#define def_syntax(T, B) \
+        case Syntax::T: \
+          tokens(static_cast<T ## _syntax const*>(s)); \
+          break;
+#include <beaker/frontend/syntax.def>
+        default:
+          break;
+        }
+
+        Const_syntax_span kids = s->children();
+        if (archive_layout(s->kind()).arity == archive_variadic)
+          varint(m_nodes, kids.size());
+        for (Syntax const* k : kids)
+          node(k);
+        ++m_num_nodes;
+      }
+
+      std::string write(Syntax const* s)
+      {
+        node(s);
+
+        std::string out;
+        out.append("BKRA", 4);
+        u32(out, archive_version);
+        u64(out, archive_fingerprint());
+        u32(out, m_syms.size());
+        u32(out, m_num_nodes);
+        for (Symbol sym : m_syms) {
+          varint(out, sym.size());
+          out.append(sym.data(), sym.size());
+        }
+        out.append(m_nodes);
+        return out;
+      }
+
+      std::unordered_map<std::string const*, std::uint32_t> m_indexes;
+      std::vector<Symbol> m_syms;
+      std::string m_nodes;
+      std::size_t m_num_nodes = 0;
+    };
+  } // namespace
+
+  std::string serialize(Syntax const* s)
+  {
+    Archive_writer w;
+    return w.write(s);
+  }
+
+  void serialize(Syntax const* s, std::filesystem::path const& p)
+  {
+    std::string buf = serialize(s);
+    std::ofstream ofs(p, std::ios::binary);
+    ofs.write(buf.data(), buf.size());
+    if (!ofs)
+      throw std::runtime_error("cannot write '" + p.string() + "'");
+  }
+
+  // Reading
+
+  Syntax_archive::Syntax_archive(std::filesystem::path const& p)
+    : m_file(p), m_first(m_file.data()), m_last(m_file.data() + m_file.size())
+  {
+    read_header();
+  }
+
+  Syntax_archive::Syntax_archive(char const* first, char const* last)
+    : m_first(first), m_last(last)
+  {
+    read_header();
+  }
+
+  void Syntax_archive::corrupt()
+  {
+    throw std::runtime_error("corrupt syntax archive");
+  }
+
+  static std::uint64_t read_fixed(Syntax_archive const& ar, char const*& p, int n)
+  {
+    std::uint64_t r = 0;
+    for (int i = 0; i < n; ++i)
+      r |= std::uint64_t(ar.byte(p)) << (i * 8);
+    return r;
+  }
+
+  void Syntax_archive::read_header()
+  {
+    char const* p = m_first;
+    if (m_last - m_first < 4 || std::memcmp(p, "BKRA", 4) != 0)
+      throw std::runtime_error("not a syntax archive");
+    p += 4;
+    if (read_fixed(*this, p, 4) != archive_version)
+      throw std::runtime_error("unsupported syntax archive version");
+    if (read_fixed(*this, p, 8) != archive_fingerprint())
+      throw std::runtime_error("syntax archive written for a different grammar");
+
+    std::size_t num_syms = read_fixed(*this, p, 4);
+    m_num_nodes = read_fixed(*this, p, 4);
+    if (num_syms > std::size_t(m_last - p))
+      corrupt();
+    m_syms.reserve(num_syms);
+    for (std::size_t i = 0; i < num_syms; ++i) {
+      std::size_t n = varint(p);
+      if (std::size_t(m_last - p) < n)
+        corrupt();
+      m_syms.emplace_back(p, n);
+      p += n;
+    }
+    m_nodes = p;
+  }
+
+  namespace
+  {
+    // Constructs a node of type T from its tokens and children. Nodes that
+    // don't store all of their tokens (e.g., introductions) are constructed
+    // with their kind.
+    template<typename T, std::size_t... Ts, std::size_t... Cs>
+    Syntax* make_syntax(Token const* toks,
+                        Syntax_seq& kids,
+                        std::index_sequence<Ts...>,
+                        std::index_sequence<Cs...>)
+    {
+      if constexpr (std::is_constructible_v<T, decltype(toks[Ts])..., decltype(kids[Cs])...>)
+        return new T(toks[Ts]..., kids[Cs]...);
+      else
+        return new T(T::this_kind, toks[Ts]..., kids[Cs]...);
+    }
+
+    template<typename T>
+    Syntax* make_syntax(Token const* toks, Syntax_seq& kids)
+    {
+      constexpr Archive_layout layout = layout_of<T>();
+      if constexpr (layout.arity == archive_variadic)
+        return new T(std::move(kids));
+      else
+        return make_syntax<T>(toks, kids,
+                              std::make_index_sequence<layout.tokens>(),
+                              std::make_index_sequence<layout.arity>());
+    }
+
+    struct Archive_reader
+    {
+      Archive_reader(Syntax_archive const& ar, Translation& trans)
+        : ar(ar), trans(trans), syms(ar.m_syms.size()), p(ar.m_nodes)
+      { }
+
+      Token token()
+      {
+        Archive_token tok = ar.token(p);
+        if (tok.kind == Token::eof_tok)
+          return Token(tok.kind, {}, tok.location);
+
+        // Intern symbols on first use.
+        std::size_t n = tok.symbol;
+        if (!syms[n].is_valid())
+          syms[n] = trans.get_symbol(tok.spelling.data(), tok.spelling.data() + tok.spelling.size());
+        return Token(tok.kind, syms[n], tok.location);
+      }
+
+      // A node whose children are being read.
+      struct Frame
+      {
+        Syntax::Kind kind;
+        Token toks[2];
+        std::size_t arity;
+        Syntax_seq kids;
+      };
+
+      static Syntax* make(Syntax::Kind kind, Token const* toks, Syntax_seq& kids)
+      {
+        switch (kind) {
+#define def_syntax(T, B) \
+        case Syntax::T: \
+          return make_syntax<T ## _syntax>(toks, kids);
+#include <beaker/frontend/syntax.def>
+        default:
+          break;
+        }
+        assert(false);
+        __builtin_unreachable();
+      }
+
+      // Reads the tree. This uses an explicit stack, since the nesting of
+      // an archive is bounded only by its size.
+      Syntax* node()
+      {
+        std::vector<Frame> stack;
+        try {
+          while (true) {
+            Syntax* s = nullptr;
+            std::uint8_t k = ar.byte(p);
+            if (k != archive_null) {
+              if (k >= archive_syntax_kinds)
+                Syntax_archive::corrupt();
+
+              Frame f;
+              f.kind = Syntax::Kind(k);
+              Archive_layout layout = archive_layout(f.kind);
+              for (std::size_t i = 0; i < layout.tokens; ++i)
+                f.toks[i] = token();
+              f.arity = layout.arity == archive_variadic ? ar.varint(p) : layout.arity;
+
+              // Each child takes at least one byte.
+              if (f.arity > std::size_t(ar.m_last - p))
+                Syntax_archive::corrupt();
+              if (f.arity != 0) {
+                f.kids.reserve(f.arity);
+                stack.push_back(std::move(f));
+                continue;
+              }
+              s = make(f.kind, f.toks, f.kids);
+            }
+
+            // Add the node to its parent, completing each parent that
+            // has all of its children.
+            while (true) {
+              if (stack.empty())
+                return s;
+              Frame& f = stack.back();
+              f.kids.push_back(s);
+              if (f.kids.size() != f.arity)
+                break;
+              s = make(f.kind, f.toks, f.kids);
+              stack.pop_back();
+            }
+          }
+        }
+        catch (...) {
+          for (Frame& f : stack)
+            for (Syntax* k : f.kids)
+              destroy(k);
+          throw;
+        }
+      }
+
+      Syntax_archive const& ar;
+      Translation& trans;
+      std::vector<Symbol> syms;
+      char const* p;
+    };
+  } // namespace
+
+  Syntax* Syntax_archive::read(Translation& trans) const
+  {
+    Archive_reader r(*this, trans);
+    return r.node();
+  }
+
+} // namespace beaker
@@ -0,0 +1,216 @@
+#ifndef BEAKER_FRONTEND_SERIALIZATION_HPP
+#define BEAKER_FRONTEND_SERIALIZATION_HPP
+
+#include <beaker/language/translation.hpp>
+#include <beaker/frontend/mapped_file.hpp>
+#include <beaker/frontend/syntax.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace beaker
+{
+  // Binary syntax format
+  //
+  // A serialized tree is a header, followed by a symbol table and a stream
+  // of nodes in pre-order. The header is:
+  //
+  //    magic        4 bytes, "BKRA"
+  //    version      u32
+  //    fingerprint  u64, a hash of `syntax.def` and `token.def`
+  //    symbols      u32, the number of symbols
+  //    nodes        u32, the number of (non-null) nodes
+  //
+  // Each symbol is a varint length followed by its characters. Each node is
+  // a kind byte (or `archive_null`), followed by its tokens and, for lists
+  // and sequences, a varint child count. The number of tokens and the arity
+  // of all other kinds is determined by the kind (see `archive_layout`). A
+  // token is its kind byte followed, for non-empty tokens, by the varint
+  // index of its symbol, and then its line and column. Empty tokens (e.g.,
+  // brackets missing after a syntax error) have no symbol.
+  //
+  // Fixed-width integers are little-endian. Varints are LEB128.
+
+  /// The version of the binary format. Increment this whenever the encoding
+  /// changes in ways not reflected by the fingerprint.
+  constexpr std::uint32_t archive_version = 2;
+
+  /// The kind byte denoting an omitted (null) subtree.
+  constexpr std::uint8_t archive_null = 0xff;
+
+  /// Denotes an arity determined by a child count in the node stream.
+  constexpr std::uint8_t archive_variadic = 0xff;
+
+  /// The number of node kinds.
+  constexpr std::uint8_t archive_syntax_kinds = 0
+#define def_syntax(T, B) + 1
+#include <beaker/frontend/syntax.def>
+    ;
+
+  /// The number of token kinds.
+  constexpr std::uint8_t archive_token_kinds = num_token_kinds;
+
+  /// Returns a hash of the node and token definitions. Archives written by
+  /// a compiler with different definitions are rejected.
+  std::uint64_t archive_fingerprint();
+
+  /// Describes the encoding of a node kind.
+  struct Archive_layout
+  {
+    std::uint8_t tokens;
+    std::uint8_t arity;
+  };
+
+  /// Returns the encoding of nodes of kind `k`.
+  Archive_layout archive_layout(Syntax::Kind k);
+
+  /// Returns the binary encoding of `s`.
+  std::string serialize(Syntax const* s);
+
+  /// Writes the binary encoding of `s` to the file `p`.
+  void serialize(Syntax const* s, std::filesystem::path const& p);
+
+  /// A token as stored in an archive. The spelling refers to the archive's
+  /// buffer, and the symbol is its index in the archive's symbol table.
+  struct Archive_token
+  {
+    Token::Kind kind;
+    std::size_t symbol;
+    std::string_view spelling;
+    Source_location location;
+  };
+
+  /// A node as stored in an archive. This provides the information needed
+  /// by clients that walk an archive without materializing its tree.
+  struct Archive_node
+  {
+    /// Returns the tokens of the node.
+    std::span<Archive_token const> tokens() const
+    {
+      return {m_toks, m_num_toks};
+    }
+
+    Syntax::Kind kind;
+    std::size_t depth;
+    std::size_t arity;
+    Archive_token m_toks[2];
+    std::size_t m_num_toks;
+  };
+
+  /// A serialized syntax tree. The tree can either be materialized, or it
+  /// can be walked in place without allocating nodes or interning symbols.
+  ///
+  /// Errors in the archive are diagnosed by throwing exceptions.
+  struct Syntax_archive
+  {
+    /// Maps the archive in the file `p`.
+    Syntax_archive(std::filesystem::path const& p);
+
+    /// Reads the archive in `[first, last)`, which must outlive this object.
+    Syntax_archive(char const* first, char const* last);
+
+    /// Returns the number of nodes in the archive.
+    std::size_t size() const
+    {
+      return m_num_nodes;
+    }
+
+    /// Materializes the tree. Symbols are interned in `trans`.
+    Syntax* read(Translation& trans) const;
+
+    /// Calls `fn` for each non-null node in pre-order.
+    template<typename F>
+    void walk(F fn) const;
+
+    void read_header();
+
+    // Decoding
+
+    [[noreturn]] static void corrupt();
+
+    std::uint8_t byte(char const*& p) const
+    {
+      if (p == m_last)
+        corrupt();
+      return *p++;
+    }
+
+    std::uint64_t varint(char const*& p) const
+    {
+      std::uint64_t n = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        std::uint8_t b = byte(p);
+        n |= std::uint64_t(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+          return n;
+      }
+      corrupt();
+    }
+
+    Archive_token token(char const*& p) const
+    {
+      std::uint8_t b = byte(p);
+      if (b >= archive_token_kinds)
+        corrupt();
+      Token::Kind k = Token::Kind(b);
+      std::uint64_t sym = 0;
+      if (k != Token::eof_tok) {
+        sym = varint(p);
+        if (sym >= m_syms.size())
+          corrupt();
+      }
+      std::size_t line = varint(p);
+      std::size_t column = varint(p);
+      if (k == Token::eof_tok)
+        return {k, 0, {}, {line, column}};
+      return {k, sym, m_syms[sym], {line, column}};
+    }
+
+    Mapped_file m_file;
+    char const* m_first;
+    char const* m_last;
+    char const* m_nodes;
+    std::size_t m_num_nodes;
+    std::vector<std::string_view> m_syms;
+  };
+
+  template<typename F>
+  void Syntax_archive::walk(F fn) const
+  {
+    // The number of child slots remaining at each level of the tree. The
+    // bottom of the stack is the slot for the root.
+    std::vector<std::size_t> stack{1};
+    char const* p = m_nodes;
+    while (!stack.empty()) {
+      if (stack.back() == 0) {
+        stack.pop_back();
+        continue;
+      }
+      --stack.back();
+
+      std::uint8_t k = byte(p);
+      if (k == archive_null)
+        continue;
+      if (k >= archive_syntax_kinds)
+        corrupt();
+
+      Archive_node node;
+      node.kind = Syntax::Kind(k);
+      node.depth = stack.size() - 1;
+      Archive_layout layout = archive_layout(node.kind);
+      node.m_num_toks = layout.tokens;
+      for (std::size_t i = 0; i < layout.tokens; ++i)
+        node.m_toks[i] = token(p);
+      node.arity = layout.arity == archive_variadic ? varint(p) : layout.arity;
+
+      fn(static_cast<Archive_node const&>(node));
+      stack.push_back(node.arity);
+    }
+  }
+
+} // namespace beaker
+
+#endif
@@ -1,7 +1,9 @@
 #include <beaker/frontend/syntax.hpp>
+#include <beaker/frontend/dump.hpp>
+#include <beaker/frontend/parser.hpp>
 
 #include <iostream>
-#include <string>
+#include <vector>
 
 namespace beaker
 {
@@ -76,28 +78,38 @@ namespace beaker
 
   namespace
   {
-    // Returns the first non-null tree in `span`.
-    Syntax const* first_nonnull(Const_syntax_span span)
+    // Returns the position of the first non-null tree in `span`.
+    std::size_t first_nonnull(Const_syntax_span span)
     {
       auto iter = std::find_if(span.begin(), span.end(), [](Syntax const* s) {
         return s != nullptr;
       });
       assert(iter != span.end());
-      return *iter;
+      return iter - span.begin();
     }
 
-    // Returns the last non-null tree in `span`.
-    Syntax const* last_nonnull(Const_syntax_span span)
+    // Returns the position of the last non-null tree in `span`.
+    std::size_t last_nonnull(Const_syntax_span span)
     {
       auto iter = std::find_if(span.rbegin(), span.rend(), [](Syntax const* s) {
         return s != nullptr;
       });
       assert(iter != span.rend());
-      return *iter;
+      return span.rend() - iter - 1;
     }
 
+    // Computes the range of a node from those of its children. If `kids`
+    // is null, the ranges of the children are computed recursively.
     struct Location_visitor : Const_syntax_visitor<Location_visitor, Source_range>
     {
+      // Returns the range of the `n`th child of `s`.
+      Source_range child(Syntax const* s, std::size_t n)
+      {
+        if (kids)
+          return kids[n];
+        return s->children()[n]->location();
+      }
+
       Source_range visit_Atom(Atom_syntax const* s)
       {
         Source_location start = s->token().start_location();
@@ -108,8 +120,8 @@ namespace beaker
       // Locations for lists and sequences.
       Source_range visit_Multiary(Multiary_syntax const* s)
       {
-        Source_location start = s->operands().front()->location().start;
-        Source_location end = s->operands().back()->location().end;
+        Source_location start = child(s, 0).start;
+        Source_location end = child(s, s->operands().size() - 1).end;
         return {start, end};
       }
 
@@ -125,14 +137,14 @@ namespace beaker
       Source_range visit_Prefix(Prefix_syntax const* s)
       {
         Source_location start = s->operation().start_location();
-        Source_location end = s->operand()->location().end;
+        Source_location end = child(s, 0).end;
         return {start, end};
       }
 
       // The range of terms like `e@`
       Source_range visit_Postfix(Postfix_syntax const* s)
       {
-        Source_location start = s->operand()->location().start;
+        Source_location start = child(s, 0).start;
         Source_location end = s->operation().end_location();
         return {start, end};
       }
@@ -140,8 +152,8 @@ namespace beaker
       // The range of terms like `e0 @ e1`
       Source_range visit_Infix(Infix_syntax const* s)
       {
-        Source_location start = s->lhs()->location().start;
-        Source_location end = s->rhs()->location().end;
+        Source_location start = child(s, 0).start;
+        Source_location end = child(s, 1).end;
         return {start, end};
       }
 
@@ -149,23 +161,23 @@ namespace beaker
       Source_range visit_Constructor(Constructor_syntax const* s)
       {
         Source_location start = s->type().start_location();
-        Source_location end = s->result()->location().end;
+        Source_location end = child(s, 1).end;
         return {start, end};
       }
 
       // The range of compound type constructors `e1 e2`.
       Source_range visit_Introduction(Introduction_syntax const* s)
       {
-        Source_location start = s->introduction()->location().start;
-        Source_location end = s->result()->location().end;
+        Source_location start = child(s, 0).start;
+        Source_location end = child(s, 1).end;
         return {start, end};
       }
 
       // The range of compound postfix expressions `e1 e2`.
       Source_range visit_Application(Application_syntax const* s)
       {
-        Source_location start = s->applicant()->location().start;
-        Source_location end = s->arguments()->location().end;
+        Source_location start = child(s, 0).start;
+        Source_location end = child(s, 1).end;
         return {start, end};
       }
 
@@ -179,11 +191,11 @@ namespace beaker
         if (Token tok = s->introducer())
           start = tok.start_location();
         else
-          start = first_nonnull(s->operands())->location().start;
+          start = child(s, first_nonnull(s->operands())).start;
         
         // The end declaration is that of the last valid subtree (the
         // initializer may be omitted).
-        Source_location end = last_nonnull(s->operands())->location().end;
+        Source_location end = child(s, last_nonnull(s->operands())).end;
 
         return {start, end};
       }
@@ -191,8 +203,10 @@ namespace beaker
       // The range of a file is that of its declaration sequence.
       Source_range visit_File(File_syntax const* s)
       {
-        return s->declarations()->location();
+        return child(s, 0);
       }
+
+      Source_range const* kids = nullptr;
     };
   } // namespace
 
@@ -202,132 +216,55 @@ namespace beaker
     return v.visit(this);
   }
 
-  // Syntax::dump
-
-  namespace
+  Source_range Syntax::location(Source_range const* kids) const
   {
-    // Print attributes for a declaration.
-    struct Dump_attrs_visitor : Const_syntax_visitor<Dump_attrs_visitor, void>
-    {
-      Dump_attrs_visitor(std::ostream& os)
-        : os(os)
-      { }
-
-      void visit_Literal(Literal_syntax const* s)
-      {
-        os << " value=" << '\'' << s->spelling() << '\'';
-      }
-
-      void visit_Identifier(Identifier_syntax const* s)
-      {
-        os << " identifier=" << '\'' << s->spelling() << '\'';
-      }
-
-      void visit_Prefix(Prefix_syntax const* s)
-      {
-        os << " operator=" << '\'' << s->operation().spelling() << '\'';
-      }
-
-      void visit_Postfix(Postfix_syntax const* s)
-      {
-        os << " operator=" << '\'' << s->operation().spelling() << '\'';
-      }
-
-      void visit_Infix(Infix_syntax const* s)
-      {
-        os << " operator=" << '\'' << s->operation().spelling( )<< '\'';
-      }
-
-      void visit_Constructor(Constructor_syntax const* s)
-      {
-        os << " type=" << '\'' << s->type().spelling() << '\'';
-      }
-
-      void visit_Introduction(Introduction_syntax const* s)
-      {
-        // Don't fall through to Constructors.
-      }
-
-      void visit_Enclosure(Enclosure_syntax const* s)
-      {
-        os << " kind=" << '\'' << s->open().spelling() << s->close().spelling() << '\'';
-      }
-
-      std::ostream& os;
-    };
-
-    struct Dump_visitor : Const_syntax_visitor<Dump_visitor, void>
-    {
-      Dump_visitor(std::ostream& os)
-        : os(os), depth(0)
-      { }
-
-      // RAII class to help indenting.
-      struct Indent
-      {
-        Indent(Dump_visitor& d)
-          : d(d)
-        {
-          ++d.depth;
-        }
-
-        ~Indent()
-        {
-          --d.depth;
-        }
-
-        Dump_visitor& d;
-      };
-
-      // Print the header for 
-      void start_line(Syntax const* s)
-      {
-        // Print the name of the node.
-        os << std::string(depth * 2, ' ') << s->kind_name();
-        
-        // Print the location of the node.
-        os << ' ' << '@' << s->location();
-      }
+    Location_visitor v;
+    v.kids = kids;
+    return v.visit(this);
+  }
 
-      void end_line(Syntax const* s)
-      {
-        os << '\n';
-      }
+  // Deferred_syntax::body
 
-      // Dump attributes of `s`
-      void visit_attributes(Syntax const* s)
-      {
-        Dump_attrs_visitor attrs(os);
-        attrs.visit(s);
-      }
+  Syntax* Deferred_syntax::body()
+  {
+    if (m_parser) {
+      m_term = m_parser->parse_deferred(m_pos);
+      m_parser = nullptr;
+    }
+    return m_term;
+  }
 
-      // Recursively visit the children of `s`.
-      void visit_children(Syntax const* s)
-      {
-        Indent indent(*this);
-        for (Syntax const* child : s->children())
-          if (child)
-            visit(child);
-      }
+  // destroy
 
-      // Prints information about each node.
-      void visit_Syntax(Syntax const* s)
-      {
-        start_line(s);
-        visit_attributes(s);
-        end_line(s);
-        visit_children(s);
+  // This uses an explicit worklist, since trees nested through binary
+  // operators can be deeper than the stack allows. A node's children are
+  // added to the worklist before the node is deleted.
+  void destroy(Syntax* s)
+  {
+    if (!s)
+      return;
+    std::vector<Syntax*> work{s};
+    while (!work.empty()) {
+      s = work.back();
+      work.pop_back();
+      for (Syntax* c : s->children())
+        if (c)
+          work.push_back(c);
+      switch (s->kind()) {
+#define def_syntax(T, B) \
+      case Syntax::T: \
+        delete static_cast<T ## _syntax*>(s); \
+        break;
+#include <beaker/frontend/syntax.def>
       }
-
-      std::ostream& os;
-      int depth;
-    };
+    }
   }
 
+  // Syntax::dump
+
   void Syntax::dump() const
   {
-    Dump_visitor v(std::cerr);
-    v.visit(this);
+    beaker::dump(this, std::cerr);
   }
 
 } // namespace
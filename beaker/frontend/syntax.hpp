@@ -3,11 +3,15 @@
 
 #include <beaker/frontend/token.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <span>
 
 namespace beaker
 {
+  struct Parser;
+
   /// The base class of all concrete syntax trees.
   ///
   /// Note that syntax is always a tree, it is not a graph. One implication
@@ -44,10 +48,21 @@ namespace beaker
     /// Returns the source range of the tree.
     Source_range location() const;
 
-    /// Dump the tree to stderr.
+    /// Returns the source range of the tree, given the ranges of its
+    /// children in `kids`, which parallels `children()`. Entries for null
+    /// children are not used. Unlike `location()`, this does not visit any
+    /// subtrees, so it takes constant time for all but lists.
+    Source_range location(Source_range const* kids) const;
+
+    /// Dump the tree to stderr. See `dump.hpp` for other formats and
+    /// destinations.
     void dump() const;
 
     Kind m_kind;
+
+    /// The id of the node in the last `Node_table` built for its tree. This
+    /// occupies padding, so it does not increase the size of any node.
+    mutable std::uint32_t m_id = -1;
   };
 
   /// A vector of syntax nodes.
@@ -255,6 +270,17 @@ namespace beaker
     { }
   };
 
+  /// Represents a syntax error. The token is the one at which the error was
+  /// diagnosed. Error nodes allow parsing to continue after an error.
+  struct Error_syntax : Atom_syntax
+  {
+    static constexpr Kind this_kind = Error;
+
+    Error_syntax(Token tok)
+      : Atom_syntax(this_kind, tok)
+    { }
+  };
+
   /// A sequence of delimited terms.
   ///
   /// TODO: This doesn't store the delimiters. I'm not sure if that's
@@ -295,6 +321,10 @@ namespace beaker
       : Unary_syntax(this_kind, t), m_open(o), m_close(c)
     { }
 
+    Enclosure_syntax(Kind k, Token o, Token c, Syntax* t)
+      : Unary_syntax(k, t), m_open(o), m_close(c)
+    { }
+
     /// Returns the opening token.
     Token open() const
     {
@@ -317,6 +347,41 @@ namespace beaker
     Token m_close;
   };
 
+  /// A brace-enclosed body whose parse is deferred until it is accessed.
+  /// Until then, the inner term is null, and the node only records where
+  /// the body starts and shares the parser of its body (see
+  /// `Parser::body_parser`), which keeps the tokens alive. The body can be
+  /// accessed after the parser that created the node is reset or destroyed,
+  /// but not after its translation is destroyed. Accessing the body is not
+  /// thread-safe.
+  ///
+  /// Once parsed, the node has the same inner term as the corresponding
+  /// enclosure.
+  struct Deferred_syntax : Enclosure_syntax
+  {
+    static constexpr Kind this_kind = Deferred;
+
+    Deferred_syntax(Token o, Token c, std::shared_ptr<Parser> p, std::size_t pos)
+      : Enclosure_syntax(this_kind, o, c, nullptr), m_parser(std::move(p)), m_pos(pos)
+    { }
+
+    Deferred_syntax(Token o, Token c, Syntax* t)
+      : Enclosure_syntax(this_kind, o, c, t), m_parser(nullptr), m_pos(0)
+    { }
+
+    /// Returns true if the body has not been parsed.
+    bool is_deferred() const
+    {
+      return m_parser != nullptr;
+    }
+
+    /// Returns the inner term, parsing it if needed.
+    Syntax* body();
+
+    std::shared_ptr<Parser> m_parser;
+    std::size_t m_pos;
+  };
+
   /// A unary prefix operator expression.
   struct Prefix_syntax : Unary_syntax
   {
@@ -583,6 +648,9 @@ namespace beaker
     }
   };
 
+  /// Deallocates the tree `s`, which may be null.
+  void destroy(Syntax* s);
+
   // Visitors
 
   enum Visitor_type
@@ -0,0 +1,73 @@
+#include <beaker/frontend/syntax_index.hpp>
+#include <beaker/frontend/location_pass.hpp>
+
+#include <algorithm>
+
+namespace beaker
+{
+  namespace
+  {
+    // Appends each node to the entries for its kind. Nodes are visited in
+    // pre-order, so their start locations are non-decreasing. The start of
+    // a node is known when it is left, and is taken from `locs`, which must
+    // precede this pass.
+    struct Index_pass : Const_syntax_pass<Index_pass>
+    {
+      Index_pass(Syntax_index& idx, Location_pass const& locs)
+        : idx(idx), locs(locs)
+      { }
+
+      void visit_Syntax(Syntax const* s)
+      {
+        Syntax_index::Entries& e = idx.m_kinds[s->kind()];
+        stack.push_back(e.nodes.size());
+        e.nodes.push_back(s);
+        e.starts.emplace_back();
+      }
+
+      void leave_Syntax(Syntax const* s)
+      {
+        idx.m_kinds[s->kind()].starts[stack.back()] = locs.range().start;
+        stack.pop_back();
+      }
+
+      Syntax_index& idx;
+      Location_pass const& locs;
+
+      // The positions of the enclosing nodes in the entries for their kinds.
+      std::vector<std::size_t> stack;
+    };
+  } // namespace
+
+  Syntax_index::Syntax_index(Syntax const* s)
+  {
+    Location_pass locs;
+    Index_pass pass(*this, locs);
+    traverse(s, locs, pass);
+  }
+
+  Const_syntax_span
+  Syntax_index::find(Syntax::Kind k, Source_location first, Source_location last) const
+  {
+    Entries const& e = m_kinds[k];
+    auto lo = std::lower_bound(e.starts.begin(), e.starts.end(), first);
+    auto hi = std::lower_bound(lo, e.starts.end(), last);
+    return Const_syntax_span(e.nodes).subspan(lo - e.starts.begin(), hi - lo);
+  }
+
+  Syntax_index const& get_syntax_index(Translation& trans, Syntax const* s)
+  {
+    if (Syntax_index const* idx = trans.get_index(s))
+      return *idx;
+    auto idx = std::make_shared<Syntax_index>(s);
+    trans.set_index(s, idx);
+    return *idx;
+  }
+
+  void destroy_indexed(Translation& trans, Syntax* s)
+  {
+    trans.forget_index(s);
+    destroy(s);
+  }
+
+} // namespace beaker
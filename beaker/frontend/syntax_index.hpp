@@ -0,0 +1,63 @@
+#ifndef BEAKER_FRONTEND_SYNTAX_INDEX_HPP
+#define BEAKER_FRONTEND_SYNTAX_INDEX_HPP
+
+#include <beaker/language/translation.hpp>
+#include <beaker/frontend/syntax.hpp>
+
+#include <vector>
+
+namespace beaker
+{
+  /// An index of the nodes of a tree by kind. For each kind, the index
+  /// stores the nodes of that kind in document order, along with their
+  /// start locations so that they can be queried by position.
+  struct Syntax_index
+  {
+    /// The number of node kinds.
+    static constexpr std::size_t num_kinds = 0
+#define def_syntax(T, B) + 1
+#include <beaker/frontend/syntax.def>
+      ;
+
+    /// Builds the index for `s` and its subtrees.
+    Syntax_index(Syntax const* s);
+
+    /// Returns the nodes of kind `k` in document order.
+    Const_syntax_span nodes(Syntax::Kind k) const
+    {
+      return m_kinds[k].nodes;
+    }
+
+    /// Returns the nodes of kind `k` that start in `[first, last)`, in
+    /// document order.
+    Const_syntax_span find(Syntax::Kind k, Source_location first, Source_location last) const;
+
+    /// Returns the nodes of kind `k` that start within `range`.
+    Const_syntax_span find(Syntax::Kind k, Source_range range) const
+    {
+      return find(k, range.start, range.end);
+    }
+
+    struct Entries
+    {
+      std::vector<Syntax const*> nodes;
+      std::vector<Source_location> starts;
+    };
+
+    Entries m_kinds[num_kinds];
+  };
+
+  /// Returns the index of the tree `s`, building it if `s` has not been
+  /// indexed. The index is kept in the translation until `s` is destroyed
+  /// by `destroy_indexed`.
+  Syntax_index const& get_syntax_index(Translation& trans, Syntax const* s);
+
+  /// Deallocates the tree `s`, which may be null, and removes its index
+  /// from `trans`. Trees that may have been indexed must be destroyed this
+  /// way, or a tree later allocated at the same address would be given the
+  /// index of this one.
+  void destroy_indexed(Translation& trans, Syntax* s);
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,94 @@
+#include <beaker/frontend/syntax_stats.hpp>
+
+#include <iomanip>
+#include <iostream>
+
+namespace beaker
+{
+  // Returns the memory of a node of kind `k`, not including its operands.
+  static std::size_t node_size(Syntax::Kind k)
+  {
+    switch (k) {
+#define def_syntax(T, B) \
+    case Syntax::T: \
+      return sizeof(T ## _syntax);
+#include <beaker/frontend/syntax.def>
+    }
+    return 0;
+  }
+
+  namespace
+  {
+    // Returns the memory of the operand list of a node, if it has one.
+    struct Operand_size : Const_syntax_visitor<Operand_size, std::size_t>
+    {
+      std::size_t visit_Multiary(Multiary_syntax const* s)
+      {
+        return s->m_terms.capacity() * sizeof(Syntax*);
+      }
+    };
+  } // namespace
+
+  void Syntax_stats_pass::visit_Syntax(Syntax const* s)
+  {
+    Syntax_stats::Kind_stats& ks = stats.m_kinds[s->kind()];
+    ++ks.nodes;
+    ks.bytes += node_size(s->kind()) + Operand_size().visit(s);
+  }
+
+  void Syntax_stats_pass::visit_Deferred(Deferred_syntax const* s)
+  {
+    visit_Syntax(s);
+    if (s->is_deferred())
+      ++stats.m_deferred;
+  }
+
+  void Syntax_stats::add(Syntax const* s)
+  {
+    Syntax_stats_pass pass(*this);
+    traverse(s, pass);
+  }
+
+  void Syntax_stats::merge(Syntax_stats const& x)
+  {
+    for (std::size_t k = 0; k < num_kinds; ++k) {
+      m_kinds[k].nodes += x.m_kinds[k].nodes;
+      m_kinds[k].bytes += x.m_kinds[k].bytes;
+    }
+    m_deferred += x.m_deferred;
+  }
+
+  std::size_t Syntax_stats::nodes() const
+  {
+    std::size_t n = 0;
+    for (Kind_stats const& ks : m_kinds)
+      n += ks.nodes;
+    return n;
+  }
+
+  std::size_t Syntax_stats::bytes() const
+  {
+    std::size_t n = 0;
+    for (Kind_stats const& ks : m_kinds)
+      n += ks.bytes;
+    return n;
+  }
+
+  void Syntax_stats::print(std::ostream& os) const
+  {
+    static char const* names[] = {
+#define def_syntax(T, B) #T,
+#include <beaker/frontend/syntax.def>
+    };
+    for (std::size_t k = 0; k < num_kinds; ++k) {
+      if (m_kinds[k].nodes == 0)
+        continue;
+      os << "  " << std::left << std::setw(14) << names[k] << std::right
+         << std::setw(12) << m_kinds[k].nodes
+         << std::setw(16) << m_kinds[k].bytes << '\n';
+    }
+    if (m_deferred != 0)
+      os << "  (" << m_deferred << " deferred bodies were not parsed, and their nodes are not counted)\n";
+  }
+
+} // namespace beaker
@@ -0,0 +1,67 @@
+#ifndef BEAKER_FRONTEND_SYNTAX_STATS_HPP
+#define BEAKER_FRONTEND_SYNTAX_STATS_HPP
+
+#include <beaker/frontend/traversal.hpp>
+
+#include <iosfwd>
+
+namespace beaker
+{
+  /// The number of nodes of each kind in some trees, and the memory they
+  /// occupy. The memory of a node includes its operand list, if it has one.
+  struct Syntax_stats
+  {
+    /// The number of node kinds.
+    static constexpr std::size_t num_kinds = 0
+#define def_syntax(T, B) + 1
+#include <beaker/frontend/syntax.def>
+      ;
+
+    /// Adds the nodes of `s` and its subtrees. Bodies of definitions that
+    /// have not been parsed are not counted, but the number of them is.
+    void add(Syntax const* s);
+
+    /// Adds the counts of `x`.
+    void merge(Syntax_stats const& x);
+
+    /// Returns the total number of nodes.
+    std::size_t nodes() const;
+
+    /// Returns the total memory of the nodes.
+    std::size_t bytes() const;
+
+    /// Writes the count and memory of each kind of node to `os`, omitting
+    /// kinds with no nodes, followed by the number of uncounted bodies.
+    void print(std::ostream& os) const;
+
+    struct Kind_stats
+    {
+      std::size_t nodes = 0;
+      std::size_t bytes = 0;
+    };
+
+    Kind_stats m_kinds[num_kinds];
+
+    /// The number of deferred bodies that were not parsed, and whose nodes
+    /// are therefore not counted.
+    std::size_t m_deferred = 0;
+  };
+
+  /// Adds each node visited to some stats. This allows nodes to be counted
+  /// in the same traversal as other passes.
+  struct Syntax_stats_pass : Const_syntax_pass<Syntax_stats_pass>
+  {
+    Syntax_stats_pass(Syntax_stats& stats)
+      : stats(stats)
+    { }
+
+    void visit_Syntax(Syntax const* s);
+
+    void visit_Deferred(Deferred_syntax const* s);
+
+    Syntax_stats& stats;
+  };
+
+} // namespace beaker
+
+#endif
@@ -37,11 +37,12 @@ namespace beaker
   ///     not prefix-expression
   Syntax* Third_parser::parse_prefix_expression()
   {
+    BEAKER_PROFILE_PRODUCTION();
     switch (lookahead())
     {
     case Token::lbracket_tok: {
       Syntax* bound = parse_bracket_group();
-      Syntax* type = parse_prefix_expression();
+      Syntax* type = nested([this] { return parse_prefix_expression(); });
       return new Introduction_syntax(bound, type);
     }
 
@@ -49,7 +50,7 @@ namespace beaker
       if (!starts_function_type(*this))
         break;
       Syntax* parms = parse_paren_list();
-      Syntax* result = parse_prefix_expression();
+      Syntax* result = nested([this] { return parse_prefix_expression(); });
       return new Introduction_syntax(parms, result);
     }
 
@@ -59,7 +60,7 @@ namespace beaker
     case Token::dash_tok:
     case Token::not_tok: {
       Token op = consume();
-      Syntax* e = parse_prefix_expression();
+      Syntax* e = nested([this] { return parse_prefix_expression(); });
       return new Prefix_syntax(op, e);
     }
     
@@ -69,22 +70,6 @@ namespace beaker
     return parse_postfix_expression();
   }
 
-
-  /// Returns a list defining the group.
-  static Syntax* make_group(std::vector<Syntax*>& ts)
-  {
-    // This only happens when there's an error and we can't accumulate
-    // a group. If we propagate errors, this shouldn't happen at all.
-    if (ts.empty())
-      return nullptr;    
-
-    // Don't allocate groups if there's only one present.    
-    if (ts.size() == 1)
-      return ts[0];
-
-    return new List_syntax(std::move(ts));
-  }
-
   /// Parse an expression-group.
   ///
   ///   parameter-group:
@@ -94,6 +79,7 @@ namespace beaker
   /// Groups are only created if multiple groups are present.
   Syntax* Third_parser::parse_parameter_group()
   {
+    BEAKER_PROFILE_PRODUCTION();
     std::vector<Syntax*> ts;
     parse_item(*this, &Third_parser::parse_parameter_list, ts);
     while (match(Token::semicolon_tok))
@@ -101,16 +87,6 @@ namespace beaker
     return make_group(ts);
   }
 
-  // Returns a list for `ts`.
-  static Syntax* make_list(std::vector<Syntax*>& ts)
-  {
-    // This only happens when an error occurred.
-    if (ts.empty())
-      return nullptr;
-
-    return new List_syntax(std::move(ts));
-  }
-
   /// Parse an parameter-list.
   ///
   ///   parameter-list:
@@ -120,6 +96,7 @@ namespace beaker
   /// This always returns a list, even if there's a single element.
   Syntax* Third_parser::parse_parameter_list()
   {
+    BEAKER_PROFILE_PRODUCTION();
     std::vector<Syntax*> ts;
     parse_item(*this, &Third_parser::parse_parameter, ts);
     while (match(Token::comma_tok))
@@ -127,4 +104,6 @@ namespace beaker
     return make_list(ts);
   }
 
+  template struct Basic_parser<Third_parser>;
+
 } // namespace beaker
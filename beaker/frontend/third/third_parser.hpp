@@ -1,21 +1,23 @@
 #ifndef BEAKER_FRONTEND_THIRD_PARSER_HPP
 #define BEAKER_FRONTEND_THIRD_PARSER_HPP
 
-#include <beaker/frontend/parser.hpp>
+#include <beaker/frontend/basic_parser.hpp>
 
 namespace beaker
 {
   /// Constructs a concrete syntax tree from a source file.
-  struct Third_parser : Parser
+  struct Third_parser : Basic_parser<Third_parser>
   {
-    using Parser::Parser;
+    using Basic_parser::Basic_parser;
 
-    Syntax* parse_prefix_expression() override;
+    Syntax* parse_prefix_expression();
     
     Syntax* parse_parameter_group();
     Syntax* parse_parameter_list();
   };
 
+  extern template struct Basic_parser<Third_parser>;
+
 } // namespace beaker
 
 #endif
@@ -2,7 +2,7 @@
 #define BEAKER_FRONTEND_TOKEN_HPP
 
 #include <beaker/language/symbol.hpp>
-#include <beaker/frontend/location.hpp>
+#include <beaker/language/location.hpp>
 
 #include <cassert>
 
@@ -64,9 +64,13 @@ namespace beaker
     /// Returns the spelling for the single token `k`.
     static const char* spelling(Kind k);
 
-    /// Returns the spelling of the token.
+    /// Returns the spelling of the token. Tokens without a symbol (e.g.,
+    /// missing tokens) have an empty spelling.
     std::string const& spelling() const
     {
+      static std::string const empty;
+      if (!m_sym.is_valid())
+        return empty;
       return m_sym.str();
     }
 
@@ -76,9 +80,12 @@ namespace beaker
       return m_loc;
     }
 
-    // Returns the end location.
+    // Returns the end location. Tokens without a symbol (e.g., missing
+    // tokens) end where they start.
     Source_location end_location() const
     {
+      if (!m_sym.is_valid())
+        return m_loc;
       return {m_loc.line, m_loc.column + m_sym.size()};
     }
 
@@ -87,6 +94,12 @@ namespace beaker
     Source_location m_loc;
   };
 
+  /// The number of token kinds.
+  constexpr std::size_t num_token_kinds = 0
+#define def_token(K) + 1
+#include <beaker/frontend/token.def>
+    ;
+
   std::ostream& operator<<(std::ostream& os, Token const& tok);
 
 } // namespace beaker
@@ -0,0 +1,135 @@
+#ifndef BEAKER_FRONTEND_TRAVERSAL_HPP
+#define BEAKER_FRONTEND_TRAVERSAL_HPP
+
+#include <beaker/frontend/syntax.hpp>
+
+#include <tuple>
+#include <vector>
+
+namespace beaker
+{
+  /// The base class of passes over const syntax. This is a CRTP class. D is
+  /// the derived implementation.
+  ///
+  /// A pass does not recurse on its own. Instead, a traversal calls the
+  /// `visit_T` hooks of each pass before visiting the children of a node and
+  /// the `leave_T` hooks after. Like visitors, unimplemented hooks fall
+  /// through to the hook of the base class, and ultimately do nothing.
+  ///
+  /// Null children are not visited, but `visit_null` is called with the
+  /// position of each one, for passes that need to account for them.
+  template<typename D>
+  struct Const_syntax_pass : Const_syntax_visitor<D, void>
+  {
+    using Const_syntax_visitor<D, void>::derived;
+
+    // By default, do nothing.
+    void leave_Syntax(Syntax const* s)
+    { }
+
+    // By default, do nothing.
+    void visit_null(std::size_t n)
+    { }
+
+#define def_syntax(T, B) \
+    void leave_## T(T ## _syntax const* s) \
+    { \
+      derived()->leave_ ## B(s); \
+    }
+#define def_abstract(T, B) def_syntax(T, B)
+#include <beaker/frontend/syntax.def>
+  };
+
+  /// Runs any number of passes in a single pre- and post-order traversal of
+  /// a tree. For each node, the hooks of each pass are called in the order
+  /// the passes are given. All dispatch is static, and the kind of each node
+  /// is switched on once per hook, not once per pass.
+  ///
+  /// The traversal is iterative, so it does not overflow the stack on deep
+  /// trees. Null subtrees are skipped, except for calling `visit_null`.
+  template<typename... Ps>
+  struct Fused_traversal
+  {
+    Fused_traversal(Ps&... ps)
+      : m_passes(ps...)
+    { }
+
+    /// Traverses `s` and its subtrees.
+    void traverse(Syntax const* s)
+    {
+      struct Frame
+      {
+        Syntax const* node;
+        Const_syntax_span children;
+        std::size_t next;
+      };
+
+      std::vector<Frame> stack;
+      enter(s);
+      stack.push_back({s, s->children(), 0});
+      while (!stack.empty()) {
+        Frame& f = stack.back();
+        if (f.next < f.children.size()) {
+          std::size_t n = f.next++;
+          Syntax const* c = f.children[n];
+          if (c) {
+            enter(c);
+            stack.push_back({c, c->children(), 0});
+          }
+          else {
+            std::apply([n](Ps&... ps) { (ps.visit_null(n), ...); }, m_passes);
+          }
+        }
+        else {
+          leave(f.node);
+          stack.pop_back();
+        }
+      }
+    }
+
+    // Calls the `visit_T` hooks of each pass.
+    void enter(Syntax const* s)
+    {
+      switch (s->kind()) {
+#define def_syntax(T, B) \
+      case Syntax::T: { \
+        auto* p = static_cast<T ## _syntax const*>(s); \
+        std::apply([p](Ps&... ps) { (ps.visit_ ## T(p), ...); }, m_passes); \
+        break; \
+      }
+#include <beaker/frontend/syntax.def>
+      default:
+        assert(false);
+      }
+    }
+
+    // Calls the `leave_T` hooks of each pass.
+    void leave(Syntax const* s)
+    {
+      switch (s->kind()) {
+#define def_syntax(T, B) \
+      case Syntax::T: { \
+        auto* p = static_cast<T ## _syntax const*>(s); \
+        std::apply([p](Ps&... ps) { (ps.leave_ ## T(p), ...); }, m_passes); \
+        break; \
+      }
+#include <beaker/frontend/syntax.def>
+      default:
+        assert(false);
+      }
+    }
+
+    std::tuple<Ps&...> m_passes;
+  };
+
+  /// Runs the passes `ps` over `s` in a single traversal.
+  template<typename... Ps>
+  void traverse(Syntax const* s, Ps&... ps)
+  {
+    Fused_traversal<Ps...> t(ps...);
+    t.traverse(s);
+  }
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,223 @@
+#include <beaker/frontend/tree_cache.hpp>
+#include <beaker/frontend/mapped_file.hpp>
+#include <beaker/frontend/serialization.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace beaker
+{
+  // An entry file is a header, the diagnostics, and the serialized tree:
+  //
+  //    magic        4 bytes, "BKRC"
+  //    version      u32
+  //    size         u64, the size of the source text
+  //    tokens       u64
+  //    diagnostics  u32, followed by each diagnostic's line and column
+  //                 (u64) and its message (u64 length and characters)
+  //
+  // Integers are native, since a cache is local to a machine.
+
+  /// The version of the entry format.
+  constexpr std::uint32_t cache_version = 1;
+
+  Tree_cache::Tree_cache(std::filesystem::path dir, std::uintmax_t limit, std::string version)
+    : m_dir(std::move(dir)), m_limit(limit), m_version(std::move(version))
+  {
+    std::filesystem::create_directories(m_dir);
+  }
+
+  std::string Tree_cache::key(std::string_view text, std::string_view variant, std::string_view options) const
+  {
+    // Hash each part with its length, so that parts can't run together.
+    // Two hashes with different seeds give a 128-bit key.
+    std::ostringstream prefix;
+    prefix << cache_version << ' ' << archive_version << ' ' << archive_fingerprint() << ' '
+           << m_version.size() << ' ' << m_version << ' '
+           << variant.size() << ' ' << variant << ' '
+           << options.size() << ' ' << options << ' '
+           << text.size() << ' ';
+    std::uint64_t a = hash_text(prefix.str());
+    std::uint64_t b = hash_text(prefix.str(), 0x84222325cbf29ce4);
+    a = hash_text(text, a);
+    b = hash_text(text, b);
+    std::ostringstream ss;
+    ss << std::hex << std::setfill('0') << std::setw(16) << a << std::setw(16) << b;
+    return ss.str();
+  }
+
+  std::filesystem::path Tree_cache::entry_path(std::string const& key) const
+  {
+    return m_dir / (key + ".bkc");
+  }
+
+  // Reads a native integer of type T from `[p, last)`.
+  template<typename T>
+  static bool read_int(char const*& p, char const* last, T& n)
+  {
+    if ((std::size_t)(last - p) < sizeof n)
+      return false;
+    std::memcpy(&n, p, sizeof n);
+    p += sizeof n;
+    return true;
+  }
+
+  template<typename T>
+  static void write_int(std::string& buf, T n)
+  {
+    buf.append(reinterpret_cast<char const*>(&n), sizeof n);
+  }
+
+  bool Tree_cache::load(std::string const& key, std::size_t size, Translation& trans, Entry& e)
+  {
+    std::filesystem::path p = entry_path(key);
+    std::error_code ec;
+    if (!std::filesystem::exists(p, ec)) {
+      ++m_misses;
+      return false;
+    }
+
+    // A malformed entry (e.g., from a different machine) is a miss, and is
+    // replaced when the text is parsed again.
+    try {
+      Mapped_file file(p);
+      char const* first = file.data();
+      char const* last = first + file.size();
+      std::uint32_t version;
+      std::uint64_t text_size;
+      std::uint64_t tokens;
+      std::uint32_t num_diags;
+      if (file.size() < 4 || std::memcmp(first, "BKRC", 4) != 0)
+        throw std::runtime_error("not a tree cache entry");
+      first += 4;
+      if (!read_int(first, last, version) || version != cache_version ||
+          !read_int(first, last, text_size) || text_size != size ||
+          !read_int(first, last, tokens) ||
+          !read_int(first, last, num_diags))
+        throw std::runtime_error("invalid tree cache entry");
+      std::vector<Diagnostic> diags(num_diags);
+      for (Diagnostic& diag : diags) {
+        std::uint64_t line;
+        std::uint64_t column;
+        std::uint64_t n;
+        if (!read_int(first, last, line) ||
+            !read_int(first, last, column) ||
+            !read_int(first, last, n) ||
+            (std::uint64_t)(last - first) < n)
+          throw std::runtime_error("invalid tree cache entry");
+        diag.location = {line, column};
+        diag.message.assign(first, n);
+        first += n;
+      }
+      Syntax_archive archive(first, last);
+      e.tree = archive.read(trans);
+      e.diags = std::move(diags);
+      e.tokens = tokens;
+    }
+    catch (std::exception const&) {
+      ++m_misses;
+      return false;
+    }
+
+    // Mark the entry as recently used.
+    std::filesystem::last_write_time(p, std::filesystem::file_time_type::clock::now(), ec);
+    ++m_hits;
+    return true;
+  }
+
+  void Tree_cache::store(std::string const& key, std::size_t size, Entry const& e)
+  {
+    std::string buf("BKRC");
+    write_int(buf, cache_version);
+    write_int(buf, (std::uint64_t)size);
+    write_int(buf, (std::uint64_t)e.tokens);
+    write_int(buf, (std::uint32_t)e.diags.size());
+    for (Diagnostic const& diag : e.diags) {
+      write_int(buf, (std::uint64_t)diag.location.line);
+      write_int(buf, (std::uint64_t)diag.location.column);
+      write_int(buf, (std::uint64_t)diag.message.size());
+      buf += diag.message;
+    }
+    buf += serialize(e.tree);
+    if (buf.size() > m_limit)
+      return;
+
+    // Write a temporary file unique to this process and thread, and then
+    // rename it over the entry.
+    std::ostringstream name;
+    name << ".tmp-" << getpid() << '-' << gettid() << '-' << key;
+    std::filesystem::path tmp = m_dir / name.str();
+    {
+      std::ofstream ofs(tmp, std::ios::binary);
+      ofs.write(buf.data(), buf.size());
+      ofs.close();
+      if (!ofs) {
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return;
+      }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, entry_path(key), ec);
+    if (ec) {
+      std::filesystem::remove(tmp, ec);
+      return;
+    }
+    ++m_stores;
+  }
+
+  void Tree_cache::trim()
+  {
+    struct File
+    {
+      std::filesystem::file_time_type time;
+      std::uintmax_t size;
+      std::filesystem::path path;
+    };
+    std::vector<File> files;
+    std::uintmax_t total = 0;
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for (auto const& entry : std::filesystem::directory_iterator(m_dir, ec)) {
+      std::filesystem::path const& p = entry.path();
+      std::filesystem::file_time_type time = entry.last_write_time(ec);
+      if (ec)
+        continue;
+
+      // Remove temporary files that are too old to belong to a writer that
+      // is still running.
+      if (p.filename().string().starts_with(".tmp-")) {
+        if (now - time > std::chrono::hours(1))
+          std::filesystem::remove(p, ec);
+        continue;
+      }
+      if (p.extension() != ".bkc")
+        continue;
+      std::uintmax_t size = entry.file_size(ec);
+      if (ec)
+        continue;
+      files.push_back({time, size, p});
+      total += size;
+    }
+    if (total <= m_limit)
+      return;
+
+    std::sort(files.begin(), files.end(), [](File const& a, File const& b) {
+      return a.time < b.time;
+    });
+    for (File const& f : files) {
+      if (total <= m_limit)
+        break;
+      // Another process may have removed the entry already.
+      if (std::filesystem::remove(f.path, ec))
+        ++m_evictions;
+      total -= f.size;
+    }
+  }
+
+} // namespace beaker
@@ -0,0 +1,90 @@
+#ifndef BEAKER_FRONTEND_TREE_CACHE_HPP
+#define BEAKER_FRONTEND_TREE_CACHE_HPP
+
+#include <beaker/language/translation.hpp>
+#include <beaker/frontend/syntax.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace beaker
+{
+  // Tree cache
+  //
+  // A tree cache is a directory of parse results: the serialized tree of a
+  // source text, its diagnostics, and its number of tokens. Entries are
+  // named by a hash of the text, the grammar and parse options, the syntax
+  // format, and the version of the compiler, so an entry is only found for
+  // the same text parsed the same way. Paths play no part, so copies of a
+  // file share an entry.
+  //
+  // Several processes can share a directory. An entry is written to a
+  // temporary file and renamed into place, so readers see either the whole
+  // entry or none. Loading an entry updates its modification time, and
+  // trimming the cache removes the least recently used entries until the
+  // cache fits its size limit.
+
+  /// Returns the FNV-1a hash of `text`, continuing from the hash `h`.
+  inline std::uint64_t hash_text(std::string_view text, std::uint64_t h = 0xcbf29ce484222325)
+  {
+    for (char c : text) {
+      h ^= (unsigned char)c;
+      h *= 0x100000001b3;
+    }
+    return h;
+  }
+
+  /// A directory of parse results.
+  struct Tree_cache
+  {
+    /// A parse result.
+    struct Entry
+    {
+      Syntax* tree = nullptr;
+      std::vector<Diagnostic> diags;
+      std::size_t tokens = 0;
+    };
+
+    /// Uses the directory `dir`, creating it if needed, holding at most
+    /// `limit` bytes of entries after trimming. `version` identifies the
+    /// compiler, whose entries are not used by other versions.
+    Tree_cache(std::filesystem::path dir, std::uintmax_t limit, std::string version);
+
+    /// Returns the key of `text` parsed with the grammar `variant` and
+    /// `options`.
+    std::string key(std::string_view text, std::string_view variant, std::string_view options) const;
+
+    /// Loads the entry for `key`, which was computed from a text of `size`
+    /// bytes, interning its symbols in `trans`. Returns false if there is no
+    /// valid entry.
+    bool load(std::string const& key, std::size_t size, Translation& trans, Entry& e);
+
+    /// Stores the entry for `key`, replacing any existing one. Failures to
+    /// write are ignored; the entry is just not cached.
+    void store(std::string const& key, std::size_t size, Entry const& e);
+
+    /// Removes the least recently used entries until the cache holds at
+    /// most its limit, and temporary files left by failed writers.
+    void trim();
+
+    /// Returns the file holding the entry for `key`.
+    std::filesystem::path entry_path(std::string const& key) const;
+
+    std::filesystem::path m_dir;
+    std::uintmax_t m_limit;
+    std::string m_version;
+
+    // Counters for statistics. These may be updated by several threads.
+    std::atomic<std::size_t> m_hits = 0;
+    std::atomic<std::size_t> m_misses = 0;
+    std::atomic<std::size_t> m_stores = 0;
+    std::atomic<std::size_t> m_evictions = 0;
+  };
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,18 @@
+#include <beaker/language/diagnostics.hpp>
+
+#include <iostream>
+
+namespace beaker
+{
+  void Diagnostic_sink::print(std::ostream& os) const
+  {
+    for (Diagnostic const& diag : m_diags)
+      os << diag << '\n';
+  }
+
+  std::ostream& operator<<(std::ostream& os, Diagnostic const& diag)
+  {
+    return os << diag.location << ": " << diag.message;
+  }
+
+} // namespace beaker
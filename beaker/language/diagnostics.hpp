@@ -0,0 +1,56 @@
+#ifndef BEAKER_LANGUAGE_DIAGNOSTICS_HPP
+#define BEAKER_LANGUAGE_DIAGNOSTICS_HPP
+
+#include <beaker/language/location.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace beaker
+{
+  /// A message about the program being translated.
+  struct Diagnostic
+  {
+    Source_location location;
+    std::string message;
+  };
+
+  /// Collects diagnostics in the order they are reported.
+  struct Diagnostic_sink
+  {
+    /// Records an error at `loc`.
+    void error(Source_location loc, std::string msg)
+    {
+      m_diags.push_back({loc, std::move(msg)});
+    }
+
+    /// Returns the number of errors reported.
+    std::size_t errors() const
+    {
+      return m_diags.size();
+    }
+
+    /// Returns true if no errors have been reported.
+    bool empty() const
+    {
+      return m_diags.empty();
+    }
+
+    /// Returns the reported diagnostics.
+    std::vector<Diagnostic> const& diagnostics() const
+    {
+      return m_diags;
+    }
+
+    /// Writes each diagnostic to `os`, one per line.
+    void print(std::ostream& os) const;
+
+    std::vector<Diagnostic> m_diags;
+  };
+
+  std::ostream& operator<<(std::ostream& os, Diagnostic const& diag);
+
+} // namespace beaker
+
+#endif
@@ -1,4 +1,4 @@
-#include <beaker/frontend/location.hpp>
+#include <beaker/language/location.hpp>
 
 #include <iostream>
 
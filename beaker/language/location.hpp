@@ -1,7 +1,8 @@
-#ifndef BEAKER_FRONTEND_LOCATION_HPP
-#define BEAKER_FRONTEND_LOCATION_HPP
+#ifndef BEAKER_LANGUAGE_LOCATION_HPP
+#define BEAKER_LANGUAGE_LOCATION_HPP
 
 #include <cassert>
+#include <compare>
 #include <iosfwd>
 
 namespace beaker
@@ -13,10 +14,9 @@ namespace beaker
   /// TODO: We also have a notion of a builtin location. It's not unknown,
   /// just generated by the compiler.
   ///
-  /// FIXME: This needs to move to a higher-level library so that source
-  /// locations can appear in ASTs. Also, we'll eventually need to bind
-  /// locations to source files, possibly through modules. There are a bunch
-  /// of techniques we can use to minimize the size of this object.
+  /// FIXME: We'll eventually need to bind locations to source files,
+  /// possibly through modules. There are a bunch of techniques we can use
+  /// to minimize the size of this object.
   struct Source_location
   {
     std::size_t line = {};
@@ -33,6 +33,9 @@ namespace beaker
     {
       return line == 0;
     }
+
+    /// Locations are ordered by line, then column.
+    friend auto operator<=>(Source_location const&, Source_location const&) = default;
   };
 
   /// Represents a range of characters in a source file.
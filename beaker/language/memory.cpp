@@ -0,0 +1,27 @@
+#include <beaker/language/memory.hpp>
+
+#include <sys/resource.h>
+
+namespace beaker
+{
+  static thread_local Allocation_count allocation_count;
+
+  void count_allocation(std::size_t n)
+  {
+    ++allocation_count.allocations;
+    allocation_count.bytes += n;
+  }
+
+  Allocation_count thread_allocations()
+  {
+    return allocation_count;
+  }
+
+  std::size_t peak_rss()
+  {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return std::size_t(ru.ru_maxrss) * 1024;
+  }
+
+} // namespace beaker
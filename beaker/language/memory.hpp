@@ -0,0 +1,28 @@
+#ifndef BEAKER_LANGUAGE_MEMORY_HPP
+#define BEAKER_LANGUAGE_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace beaker
+{
+  /// The number and total size of heap allocations.
+  struct Allocation_count
+  {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+  };
+
+  /// Records an allocation of `n` bytes by the calling thread. Allocations
+  /// are only counted by programs that replace `operator new` to call this.
+  void count_allocation(std::size_t n);
+
+  /// Returns the allocations counted for the calling thread.
+  Allocation_count thread_allocations();
+
+  /// Returns the peak resident set size of the process, in bytes.
+  std::size_t peak_rss();
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,24 @@
+#include <beaker/language/output_buffer.hpp>
+
+#include <ostream>
+
+namespace beaker
+{
+  void Output_buffer::flush()
+  {
+    char* first = m_buf.get();
+    if (m_pos != first)
+      write_through({first, std::size_t(m_pos - first)});
+    m_pos = first;
+  }
+
+  void Output_buffer::write_through(std::string_view str)
+  {
+    // A short write means the stream could not be written, which is
+    // reported through the stream's state as for formatted output.
+    std::streamsize n = str.size();
+    if (m_os.rdbuf()->sputn(str.data(), n) != n)
+      m_os.setstate(std::ios::badbit);
+  }
+
+} // namespace beaker
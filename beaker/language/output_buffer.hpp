@@ -0,0 +1,94 @@
+#ifndef BEAKER_LANGUAGE_OUTPUT_BUFFER_HPP
+#define BEAKER_LANGUAGE_OUTPUT_BUFFER_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+
+namespace beaker
+{
+  /// A large write buffer in front of an output stream. Characters are
+  /// written to the stream's buffer in large blocks, bypassing per-operation
+  /// formatting and flushing (e.g., for `std::cerr`).
+  ///
+  /// The buffer is flushed when full and when destroyed.
+  struct Output_buffer
+  {
+    static constexpr std::size_t default_size = 1 << 16;
+
+    Output_buffer(std::ostream& os, std::size_t n = default_size)
+      : m_os(os), m_buf(new char[n]), m_pos(m_buf.get()), m_last(m_buf.get() + n)
+    { }
+
+    Output_buffer(Output_buffer const&) = delete;
+
+    ~Output_buffer()
+    {
+      flush();
+    }
+
+    /// Writes the character `c`.
+    void put(char c)
+    {
+      if (m_pos == m_last)
+        flush();
+      *m_pos++ = c;
+    }
+
+    /// Writes `n` copies of the character `c`.
+    void put(char c, std::size_t n)
+    {
+      while (n != 0) {
+        if (m_pos == m_last)
+          flush();
+        std::size_t k = std::min<std::size_t>(n, m_last - m_pos);
+        std::memset(m_pos, c, k);
+        m_pos += k;
+        n -= k;
+      }
+    }
+
+    /// Writes the string `str`.
+    void write(std::string_view str)
+    {
+      if (std::size_t(m_last - m_pos) < str.size()) {
+        flush();
+        if (std::size_t(m_last - m_pos) < str.size()) {
+          write_through(str);
+          return;
+        }
+      }
+      std::memcpy(m_pos, str.data(), str.size());
+      m_pos += str.size();
+    }
+
+    /// Writes the decimal representation of `n`.
+    template<typename T>
+    void write_number(T n)
+    {
+      // Enough for any 64-bit integer.
+      constexpr std::size_t max_digits = 20;
+      if (std::size_t(m_last - m_pos) < max_digits)
+        flush();
+      m_pos = std::to_chars(m_pos, m_last, n).ptr;
+    }
+
+    /// Writes buffered characters to the stream. If they cannot all be
+    /// written, `badbit` is set on the stream.
+    void flush();
+
+    /// Writes `str` directly to the stream.
+    void write_through(std::string_view str);
+
+    std::ostream& m_os;
+    std::unique_ptr<char[]> m_buf;
+    char* m_pos;
+    char* m_last;
+  };
+
+} // namespace beaker
+
+#endif
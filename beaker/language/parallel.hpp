@@ -0,0 +1,153 @@
+#ifndef BEAKER_LANGUAGE_PARALLEL_HPP
+#define BEAKER_LANGUAGE_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+namespace beaker
+{
+  /// Returns the number of jobs to use when `n` are requested. Zero requests
+  /// one job per hardware thread.
+  inline std::size_t effective_jobs(std::size_t n)
+  {
+    if (n != 0)
+      return n;
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  /// A thread whose stack has a chosen size, so that deeply recursive work,
+  /// like parsing and dumping deeply nested trees, doesn't overflow it. A
+  /// size of zero uses the default size.
+  struct Stack_thread
+  {
+    template<typename F>
+    Stack_thread(std::size_t size, F fn)
+      : m_fn(std::move(fn))
+    {
+      pthread_attr_t attr;
+      pthread_attr_init(&attr);
+      if (size != 0)
+        pthread_attr_setstacksize(&attr, size);
+      int err = pthread_create(&m_thread, &attr, &Stack_thread::run, this);
+      pthread_attr_destroy(&attr);
+      if (err != 0)
+        throw std::runtime_error(thread_error(size));
+    }
+
+    Stack_thread(Stack_thread const&) = delete;
+    Stack_thread& operator=(Stack_thread const&) = delete;
+
+    /// Returns the message reported when a thread with a stack of `size`
+    /// bytes can't be created.
+    static std::string thread_error(std::size_t size)
+    {
+      if (size == 0)
+        return "cannot create thread";
+      return "cannot create thread with a stack of " + std::to_string(size >> 20) + " MiB";
+    }
+
+    /// Waits for the thread to finish.
+    void join()
+    {
+      pthread_join(m_thread, nullptr);
+    }
+
+    static void* run(void* p)
+    {
+      static_cast<Stack_thread*>(p)->m_fn();
+      return nullptr;
+    }
+
+    std::function<void()> m_fn;
+    pthread_t m_thread;
+  };
+
+  /// Calls `fn(w, i)` for each task `i` in `[0, n)` using up to `jobs`
+  /// workers, including the calling thread. `w` is the index of the worker
+  /// running the task, so workers can keep private state. Other workers
+  /// run on threads with stacks of `stack` bytes, or the default size if
+  /// that is zero.
+  ///
+  /// Workers claim the next unclaimed task when they finish one, so uneven
+  /// tasks are balanced across workers. If a task throws, or a worker's
+  /// thread can't be created, remaining tasks are abandoned and the first
+  /// error is rethrown once the running workers have stopped.
+  template<typename F>
+  void parallel_for(std::size_t n, std::size_t jobs, F fn, std::size_t stack = 0)
+  {
+    jobs = std::min(effective_jobs(jobs), n);
+    if (jobs <= 1) {
+      for (std::size_t i = 0; i < n; ++i)
+        fn(std::size_t(0), i);
+      return;
+    }
+
+    std::atomic<std::size_t> next = 0;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&](std::size_t w) {
+      try {
+        for (std::size_t i = next++; i < n; i = next++)
+          fn(w, i);
+      }
+      catch (...) {
+        next = n;
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+          error = std::current_exception();
+      }
+    };
+
+    std::vector<std::unique_ptr<Stack_thread>> threads;
+    threads.reserve(jobs - 1);
+    try {
+      for (std::size_t w = 1; w < jobs; ++w)
+        threads.push_back(std::make_unique<Stack_thread>(stack, [&work, w] { work(w); }));
+      work(0);
+    }
+    catch (...) {
+      // The threads already running refer to this frame, so they must be
+      // joined before the error leaves it.
+      next = n;
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+    for (std::unique_ptr<Stack_thread>& t : threads)
+      t->join();
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  /// Calls `fn()` on a new thread whose stack has `size` bytes, and waits
+  /// for it to return. Exceptions thrown by `fn` are rethrown.
+  template<typename F>
+  void call_with_stack(std::size_t size, F fn)
+  {
+    std::exception_ptr error;
+    Stack_thread thread(size, [&fn, &error] {
+      try {
+        fn();
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+    });
+    thread.join();
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+} // namespace beaker
+
+#endif
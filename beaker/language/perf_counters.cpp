@@ -0,0 +1,112 @@
+#include <beaker/language/perf_counters.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace beaker
+{
+  char const* perf_event_name(Perf_event e)
+  {
+    switch (e) {
+    case cycles_event:
+      return "cycles";
+    case instructions_event:
+      return "instructions";
+    case branch_misses_event:
+      return "branch misses";
+    case l1d_misses_event:
+      return "L1D misses";
+    case llc_misses_event:
+      return "LLC misses";
+    default:
+      break;
+    }
+    return "";
+  }
+
+  // Returns the attributes counting `e` in user space.
+  static perf_event_attr event_attr(Perf_event e)
+  {
+    constexpr std::uint64_t read_miss =
+      PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    switch (e) {
+    case cycles_event:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case instructions_event:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case branch_misses_event:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case l1d_misses_event:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+      break;
+    case llc_misses_event:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_LL | read_miss;
+      break;
+    default:
+      break;
+    }
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return attr;
+  }
+
+  Perf_counters::Perf_counters()
+  {
+    for (int e = 0; e < num_perf_events; ++e) {
+      perf_event_attr attr = event_attr((Perf_event)e);
+      m_fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+      if (m_fds[e] < 0 && m_error.empty())
+        m_error = std::string(perf_event_name((Perf_event)e)) + ": " + std::strerror(errno);
+    }
+  }
+
+  Perf_counters::~Perf_counters()
+  {
+    for (int fd : m_fds)
+      if (fd >= 0)
+        close(fd);
+  }
+
+  unsigned Perf_counters::counted() const
+  {
+    unsigned mask = 0;
+    for (int e = 0; e < num_perf_events; ++e)
+      if (m_fds[e] >= 0)
+        mask |= 1u << e;
+    return mask;
+  }
+
+  Perf_sample Perf_counters::read() const
+  {
+    Perf_sample s;
+    for (int e = 0; e < num_perf_events; ++e) {
+      if (m_fds[e] < 0)
+        continue;
+      std::uint64_t buf[3]; // The value, time enabled, and time running.
+      if (::read(m_fds[e], buf, sizeof buf) != sizeof buf || buf[2] == 0)
+        continue;
+      if (buf[2] < buf[1])
+        s.values[e] = (std::uint64_t)((double)buf[0] * buf[1] / buf[2]);
+      else
+        s.values[e] = buf[0];
+    }
+    return s;
+  }
+
+} // namespace beaker
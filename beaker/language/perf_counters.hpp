@@ -0,0 +1,83 @@
+#ifndef BEAKER_LANGUAGE_PERF_COUNTERS_HPP
+#define BEAKER_LANGUAGE_PERF_COUNTERS_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace beaker
+{
+  // Hardware performance counters
+  //
+  // Counters are opened with Linux's perf_event_open for the calling thread,
+  // counting only user-space events, and read around phases of work. Any
+  // counter that the kernel or hardware does not provide (e.g., when
+  // perf_event_paranoid forbids it, or in a virtual machine without a PMU)
+  // is left closed and reads as zero.
+
+  /// The events that are counted.
+  enum Perf_event
+  {
+    cycles_event,
+    instructions_event,
+    branch_misses_event,
+    l1d_misses_event,
+    llc_misses_event,
+    num_perf_events
+  };
+
+  /// Returns the name of `e`.
+  char const* perf_event_name(Perf_event e);
+
+  /// The counts of each event.
+  struct Perf_sample
+  {
+    Perf_sample& operator+=(Perf_sample const& x)
+    {
+      for (int e = 0; e < num_perf_events; ++e)
+        values[e] += x.values[e];
+      return *this;
+    }
+
+    Perf_sample& operator-=(Perf_sample const& x)
+    {
+      for (int e = 0; e < num_perf_events; ++e)
+        values[e] -= x.values[e];
+      return *this;
+    }
+
+    std::uint64_t values[num_perf_events] = {};
+  };
+
+  /// The counters of the thread that opened them.
+  struct Perf_counters
+  {
+    /// Opens each counter for the calling thread.
+    Perf_counters();
+
+    Perf_counters(Perf_counters const&) = delete;
+    Perf_counters& operator=(Perf_counters const&) = delete;
+
+    ~Perf_counters();
+
+    /// Returns a mask with bit `e` set if the event `e` is counted.
+    unsigned counted() const;
+
+    /// Returns the reason the first counter that couldn't be opened was
+    /// not, or an empty string if all were opened.
+    std::string const& error() const
+    {
+      return m_error;
+    }
+
+    /// Returns the counts since the counters were opened. Counts of events
+    /// that were only counted part of the time, because the hardware had
+    /// too few counters, are scaled to estimate the whole.
+    Perf_sample read() const;
+
+    int m_fds[num_perf_events];
+    std::string m_error;
+  };
+
+} // namespace beaker
+
+#endif
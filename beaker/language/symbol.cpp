@@ -1 +1,37 @@
 #include "beaker/language/symbol.hpp"
+
+namespace beaker
+{
+  Symbol Symbol_table::get(std::string_view str)
+  {
+    Shard& shard = m_shards[std::hash<std::string_view>{}(str) % num_shards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto iter = shard.strs.find(str);
+    if (iter == shard.strs.end())
+      iter = shard.strs.emplace(str).first;
+    return Symbol(&*iter);
+  }
+
+  Symbol_table::Stats Symbol_table::stats() const
+  {
+    // Each string is a node in its shard's hash table, which holds the
+    // string, a link, and its hash. Long strings are allocated separately.
+    constexpr std::size_t inline_capacity = std::string().capacity();
+    constexpr std::size_t node_size = sizeof(std::string) + 2 * sizeof(void*);
+    Stats st;
+    st.table_bytes = sizeof(*this);
+    for (Shard const& shard : m_shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      st.symbols += shard.strs.size();
+      st.table_bytes += shard.strs.bucket_count() * sizeof(void*);
+      for (std::string const& str : shard.strs) {
+        st.text_bytes += str.size();
+        st.table_bytes += node_size;
+        if (str.capacity() > inline_capacity)
+          st.table_bytes += str.capacity() + 1;
+      }
+    }
+    return st;
+  }
+
+} // namespace beaker
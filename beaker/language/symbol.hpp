@@ -4,7 +4,9 @@
 #include <cassert>
 #include <iosfwd>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 
 namespace beaker
@@ -73,29 +75,64 @@ namespace beaker
   }
 
   /// The symbol table constructs symbols.
+  ///
+  /// Symbols can be constructed concurrently, so translations on different
+  /// threads can share a table. Strings are spread across shards, each with
+  /// its own lock, so threads rarely contend.
   struct Symbol_table
   {
     Symbol get(char const* str)
     {
-      return Symbol(&*m_strs.insert(str).first);
+      return get(std::string_view(str));
     }
 
     Symbol get(char const* first, char const* last)
     {
-      return get(std::string(first, last));
+      return get(std::string_view(first, last - first));
     }
 
     Symbol get(char const* str, std::size_t n)
     {
-      return get(std::string(str, n));
+      return get(std::string_view(str, n));
     }
 
     Symbol get(std::string const& str)
     {
-      return Symbol(&*m_strs.insert(str).first);
+      return get(std::string_view(str));
     }
 
-    std::unordered_set<std::string> m_strs;
+    Symbol get(std::string_view str);
+
+    /// The size of a symbol table.
+    struct Stats
+    {
+      std::size_t symbols = 0;
+      std::size_t text_bytes = 0;  // The characters of the symbols.
+      std::size_t table_bytes = 0; // An estimate of all memory used.
+    };
+
+    /// Returns the size of the table.
+    Stats stats() const;
+
+    // Allows strings to be found by string views.
+    struct Shard_hash
+    {
+      using is_transparent = void;
+
+      std::size_t operator()(std::string_view str) const noexcept
+      {
+        return std::hash<std::string_view>{}(str);
+      }
+    };
+
+    struct Shard
+    {
+      mutable std::mutex mutex;
+      std::unordered_set<std::string, Shard_hash, std::equal_to<>> strs;
+    };
+
+    static constexpr std::size_t num_shards = 64;
+    Shard m_shards[num_shards];
   };
 
 } // namespace beaker
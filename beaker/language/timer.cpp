@@ -0,0 +1,193 @@
+#include <beaker/language/timer.hpp>
+
+#include <iomanip>
+#include <iostream>
+
+#include <time.h>
+
+namespace beaker
+{
+  static std::chrono::nanoseconds cpu_time(clockid_t clock)
+  {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+  }
+
+  std::chrono::nanoseconds thread_cpu_time()
+  {
+    return cpu_time(CLOCK_THREAD_CPUTIME_ID);
+  }
+
+  std::chrono::nanoseconds process_cpu_time()
+  {
+    return cpu_time(CLOCK_PROCESS_CPUTIME_ID);
+  }
+
+  Time_phase* Time_phase::child(std::string_view name)
+  {
+    for (std::unique_ptr<Time_phase>& c : children)
+      if (c->name == name)
+        return c.get();
+    children.push_back(std::make_unique<Time_phase>());
+    Time_phase* c = children.back().get();
+    c->name.assign(name);
+    c->parent = this;
+    return c;
+  }
+
+  Time_phase const* Time_phase::find(std::string_view name) const
+  {
+    for (std::unique_ptr<Time_phase> const& c : children)
+      if (c->name == name)
+        return c.get();
+    return nullptr;
+  }
+
+  Time_report::Time_report()
+    : m_current(&m_root), m_start(std::chrono::steady_clock::now()), m_start_cpu(process_cpu_time())
+  { }
+
+  void Time_report::start(std::string_view name)
+  {
+    if (m_trace)
+      m_trace->begin(name);
+    if (m_count_events && !m_counters) {
+      m_counters = std::make_unique<Perf_counters>();
+      m_counted |= m_counters->counted();
+      if (m_counter_error.empty())
+        m_counter_error = m_counters->error();
+    }
+    m_current = m_current->child(name);
+    Perf_sample events;
+    if (m_counters)
+      events = m_counters->read();
+    m_starts.push_back({std::chrono::steady_clock::now(), thread_cpu_time(), thread_allocations(), events});
+  }
+
+  void Time_report::stop()
+  {
+    Start s = m_starts.back();
+    m_starts.pop_back();
+    if (m_counters) {
+      Perf_sample events = m_counters->read();
+      events -= s.events;
+      m_current->events += events;
+    }
+    m_current->wall += std::chrono::steady_clock::now() - s.wall;
+    m_current->cpu += thread_cpu_time() - s.cpu;
+    ++m_current->calls;
+    Allocation_count allocs = thread_allocations();
+    m_current->allocs.allocations += allocs.allocations - s.allocs.allocations;
+    m_current->allocs.bytes += allocs.bytes - s.allocs.bytes;
+    m_current = m_current->parent;
+    if (m_trace)
+      m_trace->end();
+  }
+
+  static void merge_phase(Time_phase& a, Time_phase const& b)
+  {
+    for (std::unique_ptr<Time_phase> const& c : b.children) {
+      Time_phase* p = a.child(c->name);
+      p->wall += c->wall;
+      p->cpu += c->cpu;
+      p->calls += c->calls;
+      p->allocs.allocations += c->allocs.allocations;
+      p->allocs.bytes += c->allocs.bytes;
+      p->events += c->events;
+      merge_phase(*p, *c);
+    }
+  }
+
+  void Time_report::merge(Time_report const& r)
+  {
+    merge_phase(*m_current, r.m_root);
+    m_counted |= r.m_counted;
+    if (m_counter_error.empty())
+      m_counter_error = r.m_counter_error;
+  }
+
+  static double to_ms(Time_phase::Duration d)
+  {
+    return std::chrono::duration<double, std::milli>(d).count();
+  }
+
+  static void print_phase(std::ostream& os, Time_phase const& p, std::size_t depth, Time_phase::Duration total)
+  {
+    double share = total.count() ? 100.0 * p.wall.count() / total.count() : 0;
+    os << std::setw(12) << to_ms(p.wall)
+       << std::setw(12) << to_ms(p.cpu)
+       << std::setw(7) << std::setprecision(1) << share << '%'
+       << std::setw(9) << p.calls
+       << "  " << std::string(depth * 2, ' ') << p.name << '\n'
+       << std::setprecision(3);
+    for (std::unique_ptr<Time_phase> const& c : p.children)
+      print_phase(os, *c, depth + 1, total);
+  }
+
+  void Time_report::print(std::ostream& os) const
+  {
+    auto total = std::chrono::steady_clock::now() - m_start;
+    std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(3);
+    os << "   wall (ms)    cpu (ms)    wall    calls  phase\n";
+    for (std::unique_ptr<Time_phase> const& c : m_root.children)
+      print_phase(os, *c, 0, total);
+    os << std::setw(12) << to_ms(total)
+       << std::setw(12) << to_ms(process_cpu_time() - m_start_cpu)
+       << std::setw(7) << std::setprecision(1) << 100.0 << '%'
+       << std::setw(9) << ""
+       << "  total\n";
+    os.flags(flags);
+  }
+
+  static void print_phase_allocations(std::ostream& os, Time_phase const& p, std::size_t depth)
+  {
+    os << std::setw(14) << p.allocs.allocations
+       << std::setw(16) << p.allocs.bytes
+       << "  " << std::string(depth * 2, ' ') << p.name << '\n';
+    for (std::unique_ptr<Time_phase> const& c : p.children)
+      print_phase_allocations(os, *c, depth + 1);
+  }
+
+  void Time_report::print_allocations(std::ostream& os) const
+  {
+    os << "   allocations           bytes  phase\n";
+    for (std::unique_ptr<Time_phase> const& c : m_root.children)
+      print_phase_allocations(os, *c, 0);
+  }
+
+  static void print_phase_events(std::ostream& os, Time_phase const& p, std::size_t depth, unsigned counted)
+  {
+    for (int e = 0; e < num_perf_events; ++e) {
+      if (counted & (1u << e))
+        os << std::setw(16) << p.events.values[e];
+      else
+        os << std::setw(16) << '-';
+    }
+    std::uint64_t cycles = p.events.values[cycles_event];
+    std::uint64_t insts = p.events.values[instructions_event];
+    if (cycles != 0 && insts != 0)
+      os << std::setw(7) << std::setprecision(2) << (double)insts / cycles;
+    else
+      os << std::setw(7) << '-';
+    os << "  " << std::string(depth * 2, ' ') << p.name << '\n';
+    for (std::unique_ptr<Time_phase> const& c : p.children)
+      print_phase_events(os, *c, depth + 1, counted);
+  }
+
+  void Time_report::print_events(std::ostream& os) const
+  {
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed;
+    for (int e = 0; e < num_perf_events; ++e)
+      os << std::setw(16) << perf_event_name((Perf_event)e);
+    os << std::setw(7) << "IPC" << "  phase\n";
+    for (std::unique_ptr<Time_phase> const& c : m_root.children)
+      print_phase_events(os, *c, 0, m_counted);
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+} // namespace beaker
@@ -0,0 +1,179 @@
+#ifndef BEAKER_LANGUAGE_TIMER_HPP
+#define BEAKER_LANGUAGE_TIMER_HPP
+
+#include <beaker/language/memory.hpp>
+#include <beaker/language/perf_counters.hpp>
+#include <beaker/language/trace.hpp>
+
+#include <chrono>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace beaker
+{
+  // Phase timing
+  //
+  // A time report accumulates the wall and CPU time of named phases, which
+  // nest: a phase started while another is running is a child of it. Phases
+  // are timed by `Timer` objects, e.g.:
+  //
+  //   Timer timer(trans.time_report(), "parse");
+  //
+  // Starting a phase that has already run in the same parent adds to its
+  // times, so phases entered repeatedly (e.g., once per declaration) are
+  // reported once. Timers given a null report do nothing, so passes can
+  // time themselves at the cost of a test when no report is requested.
+  //
+  // A report must only be used by one thread. Workers keep their own and
+  // merge them when they finish.
+  //
+  // If a report has a trace, each phase is also recorded as a span of it.
+  // If a report counts events, the hardware counters of the thread using
+  // it are read around each phase.
+
+  /// The time spent in a phase and in its subphases.
+  struct Time_phase
+  {
+    using Duration = std::chrono::nanoseconds;
+
+    /// Returns the subphase `name`, creating it if needed.
+    Time_phase* child(std::string_view name);
+
+    /// Returns the subphase `name`, or null if it has not run.
+    Time_phase const* find(std::string_view name) const;
+
+    std::string name;
+    Time_phase* parent = nullptr;
+    std::vector<std::unique_ptr<Time_phase>> children;
+    Duration wall{};
+    Duration cpu{};
+    std::size_t calls = 0;
+    Allocation_count allocs;
+    Perf_sample events;
+  };
+
+  /// Accumulates the times of nested phases.
+  struct Time_report
+  {
+    /// Starts timing the whole report.
+    Time_report();
+
+    /// Starts the subphase `name` of the running phase.
+    void start(std::string_view name);
+
+    /// Stops the running phase.
+    void stop();
+
+    /// Adds the times of the phases of `r` to those of this report, as if
+    /// they had run in the running phase.
+    void merge(Time_report const& r);
+
+    /// Records phases as spans of `t`, or stops recording them if `t` is
+    /// null.
+    void set_trace(Trace* t)
+    {
+      m_trace = t;
+    }
+
+    /// Counts hardware events in each phase. The counters are opened when
+    /// the first phase starts, by the thread using the report.
+    void count_events()
+    {
+      m_count_events = true;
+    }
+
+    /// Returns true if hardware events are counted in each phase.
+    bool counts_events() const
+    {
+      return m_count_events;
+    }
+
+    /// Returns a mask with bit `e` set if the event `e` was counted by this
+    /// report, or by a report merged into it.
+    unsigned counted_events() const
+    {
+      return m_counted;
+    }
+
+    /// Returns the reason some event could not be counted, or an empty
+    /// string if all could be.
+    std::string const& counter_error() const
+    {
+      return m_counter_error;
+    }
+
+    /// Returns the top-level phase `name`, or null if it has not run.
+    Time_phase const* find(std::string_view name) const
+    {
+      return m_root.find(name);
+    }
+
+    /// Writes the phases as a table, with the wall and CPU time of each,
+    /// and the share of the total wall time. Subphases are indented below
+    /// their parents. The total is the time since the report was created.
+    void print(std::ostream& os) const;
+
+    /// Writes the phases as a table, with the number and total size of the
+    /// heap allocations made in each. See `count_allocation`.
+    void print_allocations(std::ostream& os) const;
+
+    /// Writes the phases as a table, with the counted hardware events and
+    /// the instructions per cycle of each. Events that were not counted are
+    /// shown as `-`.
+    void print_events(std::ostream& os) const;
+
+    Time_phase m_root;
+    Time_phase* m_current;
+
+    // The start times of the running phases, innermost last.
+    struct Start
+    {
+      std::chrono::steady_clock::time_point wall;
+      Time_phase::Duration cpu;
+      Allocation_count allocs;
+      Perf_sample events;
+    };
+    std::vector<Start> m_starts;
+    std::chrono::steady_clock::time_point m_start;
+    Time_phase::Duration m_start_cpu;
+    Trace* m_trace = nullptr;
+    bool m_count_events = false;
+    std::unique_ptr<Perf_counters> m_counters;
+    unsigned m_counted = 0;
+    std::string m_counter_error;
+  };
+
+  /// Times a phase of a report from its construction to its destruction.
+  /// If the report is null, nothing is timed.
+  struct Timer
+  {
+    Timer(Time_report* r, std::string_view name)
+      : m_report(r)
+    {
+      if (m_report)
+        m_report->start(name);
+    }
+
+    Timer(Timer const&) = delete;
+
+    ~Timer()
+    {
+      if (m_report)
+        m_report->stop();
+    }
+
+    Time_report* m_report;
+  };
+
+  /// Returns the CPU time used by the calling thread.
+  std::chrono::nanoseconds thread_cpu_time();
+
+  /// Returns the CPU time used by the process.
+  std::chrono::nanoseconds process_cpu_time();
+
+} // namespace beaker
+
+#endif
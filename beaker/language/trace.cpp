@@ -0,0 +1,108 @@
+#include <beaker/language/trace.hpp>
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+
+#include <unistd.h>
+
+namespace beaker
+{
+  // Identifies traces, so that the buffer cached by a thread for one trace
+  // is not used for another created at the same address.
+  static std::atomic<std::uint64_t> next_trace_id = 1;
+
+  Trace::Trace()
+    : m_id(next_trace_id++), m_start(std::chrono::steady_clock::now())
+  { }
+
+  Trace_buffer& Trace::buffer()
+  {
+    thread_local std::uint64_t owner = 0;
+    thread_local Trace_buffer* buf = nullptr;
+    if (owner != m_id) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_buffers.push_back(std::make_unique<Trace_buffer>());
+      buf = m_buffers.back().get();
+      buf->tid = m_buffers.size();
+      owner = m_id;
+    }
+    return *buf;
+  }
+
+  void Trace::begin(std::string_view name, char const* arg_name, std::string arg)
+  {
+    Trace_event e{'B', std::chrono::steady_clock::now(), std::string(name), arg_name, std::move(arg)};
+    buffer().events.push_back(std::move(e));
+  }
+
+  void Trace::end()
+  {
+    buffer().events.push_back({'E', std::chrono::steady_clock::now(), {}, nullptr, {}});
+  }
+
+  // Writes `str` as a JSON string.
+  static void write_string(std::ostream& os, std::string_view str)
+  {
+    os << '"';
+    for (char c : str) {
+      switch (c) {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      case '\n':
+        os << "\\n";
+        break;
+      case '\t':
+        os << "\\t";
+        break;
+      default:
+        if ((unsigned char)c < 0x20)
+          os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+        else
+          os << c;
+        break;
+      }
+    }
+    os << '"';
+  }
+
+  void Trace::write(std::ostream& os) const
+  {
+    std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(3);
+    int pid = getpid();
+    char const* sep = "\n";
+    os << "{\"traceEvents\":[";
+    for (std::unique_ptr<Trace_buffer> const& buf : m_buffers) {
+      // Name each thread, so the timeline labels them.
+      os << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+         << ",\"tid\":" << buf->tid << ",\"args\":{\"name\":\"thread "
+         << buf->tid << "\"}}";
+      sep = ",\n";
+      for (Trace_event const& e : buf->events) {
+        double ts = std::chrono::duration<double, std::micro>(e.time - m_start).count();
+        os << sep << "{\"ph\":\"" << e.kind << "\",\"pid\":" << pid
+           << ",\"tid\":" << buf->tid << ",\"ts\":" << ts;
+        if (e.kind == 'B') {
+          os << ",\"name\":";
+          write_string(os, e.name);
+          if (e.arg_name) {
+            os << ",\"args\":{";
+            write_string(os, e.arg_name);
+            os << ':';
+            write_string(os, e.arg);
+            os << '}';
+          }
+        }
+        os << '}';
+      }
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    os.flags(flags);
+  }
+
+} // namespace beaker
@@ -0,0 +1,112 @@
+#ifndef BEAKER_LANGUAGE_TRACE_HPP
+#define BEAKER_LANGUAGE_TRACE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace beaker
+{
+  // Tracing
+  //
+  // A trace records when spans of work begin and end on each thread, and
+  // is written as Chrome trace-event JSON, which chrome://tracing and
+  // Perfetto show as a timeline per thread. Spans are recorded by
+  // `Trace_span` objects, e.g.:
+  //
+  //   Trace_span span(trans.trace(), "declaration", "line", n);
+  //
+  // Spans nest on each thread. Each thread appends to its own buffer, so
+  // recording a span never waits for other threads. A thread only takes a
+  // lock the first time it records into a trace. Spans given a null trace
+  // do nothing.
+  //
+  // A trace must only be written after the threads recording into it have
+  // finished.
+
+  /// The beginning or end of a span.
+  struct Trace_event
+  {
+    char kind; // 'B' for the beginning and 'E' for the end.
+    std::chrono::steady_clock::time_point time;
+    std::string name;
+    char const* arg_name = nullptr;
+    std::string arg;
+  };
+
+  /// The events recorded by one thread.
+  struct Trace_buffer
+  {
+    std::size_t tid;
+    std::vector<Trace_event> events;
+  };
+
+  /// Records spans on each thread.
+  struct Trace
+  {
+    /// Starts the trace. Event times are relative to its start.
+    Trace();
+
+    /// Begins the span `name` on the calling thread. If `arg_name` is
+    /// non-null, the span is annotated with `arg_name` set to `arg`.
+    void begin(std::string_view name, char const* arg_name = nullptr, std::string arg = {});
+
+    /// Ends the innermost span on the calling thread.
+    void end();
+
+    /// Writes the events as a Chrome trace-event JSON object.
+    void write(std::ostream& os) const;
+
+    /// Returns the buffer of the calling thread, creating it if needed.
+    Trace_buffer& buffer();
+
+    std::uint64_t m_id;
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Trace_buffer>> m_buffers;
+  };
+
+  /// Records a span of a trace from its construction to its destruction.
+  /// If the trace is null, nothing is recorded.
+  struct Trace_span
+  {
+    Trace_span(Trace* t, std::string_view name)
+      : m_trace(t)
+    {
+      if (m_trace)
+        m_trace->begin(name);
+    }
+
+    Trace_span(Trace* t, std::string_view name, char const* arg_name, std::string_view arg)
+      : m_trace(t)
+    {
+      if (m_trace)
+        m_trace->begin(name, arg_name, std::string(arg));
+    }
+
+    Trace_span(Trace* t, std::string_view name, char const* arg_name, std::size_t arg)
+      : m_trace(t)
+    {
+      if (m_trace)
+        m_trace->begin(name, arg_name, std::to_string(arg));
+    }
+
+    Trace_span(Trace_span const&) = delete;
+
+    ~Trace_span()
+    {
+      if (m_trace)
+        m_trace->end();
+    }
+
+    Trace* m_trace;
+  };
+
+} // namespace beaker
+
+#endif
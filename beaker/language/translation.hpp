@@ -1,39 +1,116 @@
 #ifndef BEAKER_LANGUAGE_TRANSLATION_HPP
 #define BEAKER_LANGUAGE_TRANSLATION_HPP
 
+#include <beaker/language/diagnostics.hpp>
 #include <beaker/language/symbol.hpp>
 
+#include <memory>
+#include <unordered_map>
+
 namespace beaker
 {
+  struct Syntax;
+  struct Syntax_index;
+  struct Time_report;
+  struct Trace;
+
   /// Maintains language-level context for the translation and creation of
   /// Beaker programs.
   struct Translation
   {
+    Translation()
+      : m_syms(std::make_shared<Symbol_table>())
+    { }
+
+    /// Creates a translation using the symbol table `syms`. Translations on
+    /// different threads can share a table.
+    explicit Translation(std::shared_ptr<Symbol_table> syms)
+      : m_syms(std::move(syms))
+    { }
+
     /// Returns the symbol table for this translation.
     Symbol_table& symbol_table()
     {
-      return m_syms;
+      return *m_syms;
+    }
+
+    /// Returns the diagnostics reported during translation.
+    Diagnostic_sink& diagnostics()
+    {
+      return m_diags;
     }
 
     /// Returns a symbol for `str`.
     Symbol get_symbol(std::string const& str)
     {
-      return m_syms.get(str);
+      return m_syms->get(str);
     }
 
     /// Returns a symbol for `str`.
     Symbol get_symbol(char const* str)
     {
-      return m_syms.get(str);
+      return m_syms->get(str);
     }
 
     /// Returns a symbol for the characters is `[first, last)`.
     Symbol get_symbol(char const* first, char const* last)
     {
-      return m_syms.get(first, last);
+      return m_syms->get(first, last);
+    }
+
+    /// Returns the report used to time the phases of translation, or null
+    /// if phases are not timed.
+    Time_report* time_report() const
+    {
+      return m_times;
+    }
+
+    /// Times phases of translation using `r`, or stops timing if `r` is null.
+    void set_time_report(Time_report* r)
+    {
+      m_times = r;
+    }
+
+    /// Returns the trace recording spans of translation, or null if it is
+    /// not traced. Unlike the time report, the trace may be used by
+    /// several threads.
+    Trace* trace() const
+    {
+      return m_trace;
+    }
+
+    /// Records spans of translation in `t`, or stops tracing if `t` is null.
+    void set_trace(Trace* t)
+    {
+      m_trace = t;
+    }
+
+    /// Returns the index of the tree `s`, or null if `s` has not been
+    /// indexed. See `get_syntax_index` in the frontend.
+    Syntax_index const* get_index(Syntax const* s) const
+    {
+      auto iter = m_indexes.find(s);
+      return iter != m_indexes.end() ? iter->second.get() : nullptr;
+    }
+
+    /// Associates the index `idx` with the tree `s`.
+    void set_index(Syntax const* s, std::shared_ptr<Syntax_index const> idx)
+    {
+      m_indexes[s] = std::move(idx);
+    }
+
+    /// Removes the index of the tree `s`, if any. This must be called when
+    /// `s` is destroyed, since indexes are keyed by address.
+    void forget_index(Syntax const* s)
+    {
+      m_indexes.erase(s);
     }
 
-    Symbol_table m_syms;
+    std::shared_ptr<Symbol_table> m_syms;
+    Diagnostic_sink m_diags;
+    std::unordered_map<Syntax const*, std::shared_ptr<Syntax_index const>> m_indexes;
+    Time_report* m_times = nullptr;
+    Trace* m_trace = nullptr;
   };
 
 } // namespace beaker
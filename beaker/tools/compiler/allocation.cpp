@@ -0,0 +1,31 @@
+#include <beaker/language/memory.hpp>
+
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions so that allocations can be
+// reported by phase (see -stats). Counting an allocation costs a pair of
+// thread-local increments. Array and non-throwing forms call these.
+
+void* operator new(std::size_t n)
+{
+  beaker::count_allocation(n);
+  while (true) {
+    if (void* p = std::malloc(n ? n : 1))
+      return p;
+    std::new_handler h = std::get_new_handler();
+    if (!h)
+      throw std::bad_alloc();
+    h();
+  }
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
@@ -0,0 +1,158 @@
+#include "compare.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace beaker
+{
+  namespace
+  {
+    // The measurements of a parse, which are sent from the child process
+    // that parses to its parent.
+    struct Grammar_stats
+    {
+      std::uint64_t tokens;
+      std::uint64_t nodes;
+      std::uint64_t lookahead;
+      std::uint64_t errors;
+      std::uint64_t lex_ns;
+      std::uint64_t parse_ns;
+    };
+
+    std::size_t count_nodes(Syntax const* s)
+    {
+      std::size_t n = 1;
+      for (Syntax const* c : s->children())
+        if (c)
+          n += count_nodes(c);
+      return n;
+    }
+
+    Grammar_stats measure(Grammar_input const& in)
+    {
+      using Clock = std::chrono::steady_clock;
+      auto ns = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+      };
+
+      Translation trans;
+      Clock::time_point t0 = Clock::now();
+      std::unique_ptr<Parser> p = in.make(trans);
+      Clock::time_point t1 = Clock::now();
+      Syntax* s = p->parse_file();
+      Clock::time_point t2 = Clock::now();
+
+      Grammar_stats st;
+      st.tokens = p->tokens()->toks.size();
+      st.nodes = count_nodes(s);
+      st.lookahead = p->max_lookahead();
+      st.errors = trans.diagnostics().errors();
+      st.lex_ns = ns(t1 - t0);
+      st.parse_ns = ns(t2 - t1);
+      return st;
+    }
+
+    // A child process parsing an input.
+    struct Child
+    {
+      pid_t pid;
+      int fd;
+    };
+
+    // Parses `in` in a new process, which writes its measurements to a pipe.
+    Child spawn(Grammar_input const& in)
+    {
+      int fds[2];
+      if (::pipe(fds) < 0)
+        throw std::runtime_error("cannot create pipe");
+      std::cout.flush();
+      std::cerr.flush();
+      pid_t pid = ::fork();
+      if (pid < 0)
+        throw std::runtime_error("cannot fork");
+      if (pid == 0) {
+        ::close(fds[0]);
+        int status = 0;
+        try {
+          Grammar_stats st = measure(in);
+          if (::write(fds[1], &st, sizeof st) != sizeof st)
+            status = 1;
+        }
+        catch (std::exception const& err) {
+          std::cerr << in.path.string() << ": " << err.what() << '\n';
+          status = 1;
+        }
+        std::cerr.flush();
+        ::_exit(status);
+      }
+      ::close(fds[1]);
+      return {pid, fds[0]};
+    }
+
+    // Writes `n` with thousands separators, e.g. 1,234,567.
+    std::string group_digits(std::uint64_t n)
+    {
+      std::string s = std::to_string(n);
+      for (int i = (int)s.size() - 3; i > 0; i -= 3)
+        s.insert(i, ",");
+      return s;
+    }
+  } // namespace
+
+  bool compare_grammars(std::span<Grammar_input const> inputs, std::ostream& os)
+  {
+    std::vector<Child> children;
+    for (Grammar_input const& in : inputs)
+      children.push_back(spawn(in));
+
+    os << std::left << std::setw(8) << "grammar"
+       << std::right << std::setw(12) << "tokens"
+       << std::setw(10) << "lex ms"
+       << std::setw(10) << "parse ms"
+       << std::setw(14) << "tokens/s"
+       << std::setw(12) << "nodes"
+       << std::setw(11) << "lookahead"
+       << std::setw(10) << "peak KB"
+       << std::setw(8) << "errors"
+       << "  file\n";
+
+    bool ok = true;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+      Grammar_stats st;
+      bool got = ::read(children[i].fd, &st, sizeof st) == sizeof st;
+      ::close(children[i].fd);
+      int status;
+      struct rusage ru;
+      ::wait4(children[i].pid, &status, 0, &ru);
+      if (!got || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        os << std::left << std::setw(8) << inputs[i].name << "  failed  "
+           << inputs[i].path.string() << '\n';
+        ok = false;
+        continue;
+      }
+
+      double secs = (st.lex_ns + st.parse_ns) / 1e9;
+      std::uint64_t rate = secs > 0 ? st.tokens / secs : 0;
+      os << std::left << std::setw(8) << inputs[i].name
+         << std::right << std::setw(12) << group_digits(st.tokens)
+         << std::setw(10) << std::fixed << std::setprecision(2) << st.lex_ns / 1e6
+         << std::setw(10) << st.parse_ns / 1e6
+         << std::setw(14) << group_digits(rate)
+         << std::setw(12) << group_digits(st.nodes)
+         << std::setw(11) << st.lookahead
+         << std::setw(10) << group_digits(ru.ru_maxrss)
+         << std::setw(8) << st.errors
+         << "  " << inputs[i].path.string() << '\n';
+    }
+    return ok;
+  }
+
+} // namespace beaker
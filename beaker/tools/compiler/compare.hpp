@@ -0,0 +1,35 @@
+#ifndef BEAKER_TOOLS_COMPILER_COMPARE_HPP
+#define BEAKER_TOOLS_COMPILER_COMPARE_HPP
+
+#include <beaker/frontend/parser.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace beaker
+{
+  /// A file to parse when comparing grammars, and how to parse it.
+  struct Grammar_input
+  {
+    std::string name;
+    std::filesystem::path path;
+    std::function<std::unique_ptr<Parser>(Translation&)> make;
+  };
+
+  /// Parses each input in a separate process, all in parallel, and writes
+  /// a table of their parse costs to `os`: the lexing and parsing time,
+  /// tokens per second, nodes in the tree, the largest lookahead distance,
+  /// and the peak memory of the process. Returns false if any input could
+  /// not be parsed.
+  ///
+  /// Each process starts as a copy of this one, so peak memory includes
+  /// that of the caller at the time of the call.
+  bool compare_grammars(std::span<Grammar_input const> inputs, std::ostream& os);
+
+} // namespace beaker
+
+#endif
@@ -1,14 +1,40 @@
+#include <beaker/language/parallel.hpp>
+#include <beaker/language/memory.hpp>
+#include <beaker/language/timer.hpp>
+#include <beaker/language/trace.hpp>
 #include <beaker/frontend/syntax.hpp>
+#include <beaker/frontend/syntax_index.hpp>
+#include <beaker/frontend/syntax_stats.hpp>
+#include <beaker/frontend/dump.hpp>
+#include <beaker/frontend/location_pass.hpp>
+#include <beaker/frontend/parse_profile.hpp>
+#include <beaker/frontend/serialization.hpp>
+#include <beaker/frontend/tree_cache.hpp>
 #include <beaker/frontend/first/first_parser.hpp>
 #include <beaker/frontend/second/second_parser.hpp>
 #include <beaker/frontend/third/third_parser.hpp>
 #include <beaker/frontend/fourth/fourth_parser.hpp>
 
+#include "compare.hpp"
+#include "server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <glob.h>
+
 using namespace beaker;
 
 enum Language
@@ -18,14 +44,15 @@ enum Language
   second_lang,  // extension .bkr2
   third_lang,   // extension .bkr3
   fourth_lang,  // extension .bkr4
+  archive_lang, // extension .bka (a serialized syntax tree)
 };
 
 // Parse the value of the -language flag.
-Language parse_language(int arg, int argc, char* argv[])
+Language parse_language(std::size_t arg, std::vector<std::string> const& args)
 {
-  if (arg >= argc)
+  if (arg >= args.size())
     throw std::runtime_error("missing language");
-  std::string lang = argv[arg];
+  std::string const& lang = args[arg];
   if (lang == "first")
     return first_lang;
   if (lang == "second")
@@ -49,31 +76,764 @@ Language infer_language(std::filesystem::path const& p)
     return third_lang;
   if (ext == ".bkr4")
     return fourth_lang;
+  if (ext == ".bka")
+    return archive_lang;
   throw std::runtime_error("unknown language");
 }
 
+// Returns the name of the language variant `lang`.
+static char const* language_name(Language lang)
+{
+  switch (lang) {
+  case default_lang:
+  case first_lang:
+    return "first";
+  case second_lang:
+    return "second";
+  case third_lang:
+    return "third";
+  case fourth_lang:
+    return "fourth";
+  case archive_lang:
+    return "archive";
+  }
+  return "";
+}
+
+// Closes `ofs`, an output file, reporting any failure to write it.
+static void close_output(std::ofstream& ofs)
+{
+  ofs.close();
+  if (!ofs)
+    throw std::runtime_error("cannot write output file");
+}
+
+// Returns a string identifying this build of the compiler, so that parse
+// results cached by another build, whose parser may differ, are not used.
+static std::string build_id()
+{
+  std::error_code ec;
+  std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+  if (ec)
+    return __DATE__ " " __TIME__;
+  std::uintmax_t size = std::filesystem::file_size(exe, ec);
+  auto time = std::filesystem::last_write_time(exe, ec);
+  return std::to_string(size) + ' ' + std::to_string(time.time_since_epoch().count());
+}
+
+// Returns the text of the file `p`.
+static std::string read_input(Translation& trans, std::filesystem::path const& p)
+{
+  Timer timer(trans.time_report(), "read");
+  return read_file(p);
+}
+
+// Returns a parser for `text`, the contents of `p`.
+static std::unique_ptr<Parser> make_parser(Language lang, Translation& trans, std::filesystem::path const& p, std::string text)
+{
+  switch (lang) {
+  case default_lang:
+  case first_lang:
+    return std::make_unique<First_parser>(trans, p, std::move(text));
+  case second_lang:
+    return std::make_unique<Second_parser>(trans, p, std::move(text));
+  case third_lang:
+    return std::make_unique<Third_parser>(trans, p, std::move(text));
+  case fourth_lang:
+    return std::make_unique<Fourth_parser>(trans, p, std::move(text));
+  default:
+    break;
+  }
+  assert(false);
+  __builtin_unreachable();
+}
+
 static std::unique_ptr<Parser> make_parser(Language lang, Translation& trans, std::filesystem::path const& p)
+{
+  return make_parser(lang, trans, p, read_input(trans, p));
+}
+
+// Returns a parser that reads `p` from `is` one declaration at a time.
+static std::unique_ptr<Parser> make_stream_parser(Language lang, Translation& trans, std::filesystem::path const& p, std::istream& is)
 {
   switch (lang) {
   case default_lang:
   case first_lang:
-    return std::make_unique<First_parser>(trans, p);
+    return std::make_unique<First_parser>(trans, p, is);
   case second_lang:
-    return std::make_unique<Second_parser>(trans, p);
+    return std::make_unique<Second_parser>(trans, p, is);
   case third_lang:
-    return std::make_unique<Third_parser>(trans, p);
+    return std::make_unique<Third_parser>(trans, p, is);
   case fourth_lang:
-    return std::make_unique<Fourth_parser>(trans, p);
+    return std::make_unique<Fourth_parser>(trans, p, is);
   default:
-    assert(false);
+    break;
   }
+  assert(false);
+  __builtin_unreachable();
 }
 
-int main(int argc, char* argv[])
+// Parses the whole file with `parser`, timing the parse by language.
+static Syntax* parse_input(Language lang, Translation& trans, Parser& parser)
 {
-  if (argc == 1)
-    throw std::runtime_error("usage error");
+  Timer timer(trans.time_report(), "parse");
+  Timer variant(trans.time_report(), language_name(lang));
+  return parser.parse_file();
+}
+
+// Parses `text`, the new contents of the source file `p`, with `parser`,
+// which was made for its previous contents. The previous contents are parsed
+// first, and then the new ones are reparsed from their tree, reusing the
+// declarations that the edit did not touch. Only the diagnostics of the
+// reparse are reported.
+static Syntax* reparse_input(Language lang, Translation& trans, Parser& parser, std::filesystem::path const& p, std::string_view text)
+{
+  Syntax* old = parse_input(lang, trans, parser);
+  trans.diagnostics().m_diags.clear();
+  std::shared_ptr<Token_stream const> prev = parser.tokens();
+  parser.reset(p, text);
+  Timer timer(trans.time_report(), "reparse");
+  return parser.reparse(old, *prev);
+}
+
+// Frees the tree `s`, timing its destruction.
+static void destroy_tree(Translation& trans, Syntax* s)
+{
+  Timer timer(trans.time_report(), "teardown");
+  destroy_indexed(trans, s);
+}
+
+// The amount of input that was compiled, used to report rates, and the
+// memory used for it. Nodes are only counted if requested by -stats.
+struct Compile_stats
+{
+  std::uintmax_t bytes = 0;
+  std::size_t tokens = 0;
+  std::size_t token_bytes = 0;
+  Symbol_table::Stats symbols;
+  std::optional<Syntax_stats> nodes;
+
+  // Adds the tokens of `p`, including the memory of their bracket matches.
+  void add_tokens(Parser const& p)
+  {
+    std::shared_ptr<Token_stream const> toks = p.tokens();
+    tokens += toks->toks.size();
+    token_bytes += toks->toks.capacity() * sizeof(Token) + toks->matches.capacity() * sizeof(std::size_t);
+  }
+
+  // Adds the nodes of `s`, if nodes are counted.
+  void add_nodes(Syntax const* s)
+  {
+    if (nodes)
+      nodes->add(s);
+  }
+
+  // Returns the ranges of the nodes of `s` in pre-order, adding its nodes
+  // in the same traversal if nodes are counted.
+  std::vector<Source_range> add_nodes_and_locations(Syntax const* s)
+  {
+    if (!nodes)
+      return locations(s);
+    Syntax_stats_pass count(*nodes);
+    return locations(s, count);
+  }
+
+  // Adds the counts of `x`, except for symbols.
+  void merge(Compile_stats const& x)
+  {
+    bytes += x.bytes;
+    tokens += x.tokens;
+    token_bytes += x.token_bytes;
+    if (nodes && x.nodes)
+      nodes->merge(*x.nodes);
+  }
+};
+
+// Dumps `s` to `os`, timing the dump, and adds its nodes to `work`.
+static void dump_tree(Translation& trans, Syntax const* s, std::ostream& os, Dump_format format, Compile_stats& work)
+{
+  Timer timer(trans.time_report(), "dump");
+  std::vector<Source_range> ranges = work.add_nodes_and_locations(s);
+  dump(s, ranges.data(), os, format);
+}
+
+// Writes the memory used by symbols, tokens, and trees, the heap allocations
+// made in each phase of `r`, and the peak memory of the process to stderr.
+static void print_stats(Time_report const& r, Compile_stats const& work, Tree_cache const* cache)
+{
+  std::cerr << "===-- statistics --===\n"
+            << "symbols:      " << std::setw(12) << work.symbols.symbols
+            << "  (" << work.symbols.text_bytes << " bytes of text, "
+            << work.symbols.table_bytes << " bytes in table)\n";
+  // Tokens are released as they are parsed when streaming, and not counted.
+  if (work.tokens != 0)
+    std::cerr << "tokens:       " << std::setw(12) << work.tokens
+              << "  (" << work.token_bytes << " bytes in buffers)\n";
+  if (work.nodes) {
+    std::cerr << "syntax nodes: " << std::setw(12) << work.nodes->nodes()
+              << "  (" << work.nodes->bytes() << " bytes)\n";
+    work.nodes->print(std::cerr);
+  }
+  if (cache)
+    std::cerr << "tree cache:   " << std::setw(12) << cache->m_hits << " hits, "
+              << cache->m_misses << " misses, " << cache->m_stores << " stored, "
+              << cache->m_evictions << " evicted\n";
+  std::cerr << "heap allocations by phase:\n";
+  r.print_allocations(std::cerr);
+  std::cerr << "peak RSS:     " << std::setw(12) << peak_rss() / 1024 << " KB\n";
+}
+
+// Writes `r` to stderr, followed by the rates at which input was read,
+// lexed, and parsed.
+static void print_time_report(Time_report const& r, Compile_stats const& work)
+{
+  std::cerr << "===-- time report --===\n";
+  r.print(std::cerr);
+  Time_phase::Duration d{};
+  for (char const* name : {"read", "lex", "parse"})
+    if (Time_phase const* p = r.find(name))
+      d += p->wall;
+  double secs = std::chrono::duration<double>(d).count();
+  if (secs > 0) {
+    std::cerr << std::fixed << std::setprecision(0) << "read, lex, and parse: ";
+    if (work.tokens != 0)
+      std::cerr << work.tokens / secs << " tokens/s, ";
+    std::cerr << work.bytes / secs << " bytes/s\n";
+  }
+}
+
+// Adds the costs of the productions parsed by `p` to `prof`, if it is
+// non-null and the parser is profiled.
+static void add_profile(Parse_profile* prof, Parser const& p)
+{
+#ifdef BEAKER_PARSER_PROFILE
+  if (prof)
+    prof->merge(p.profile());
+#endif
+}
+
+// Writes the hardware events counted in each phase of `r` to stderr,
+// followed by the events per token of lexing, parsing, and dumping.
+static void print_perf_counters(Time_report const& r, Compile_stats const& work)
+{
+  std::cerr << "===-- performance counters --===\n";
+  if (r.counted_events() == 0) {
+    std::cerr << "hardware counters unavailable: " << r.counter_error() << '\n';
+    return;
+  }
+  if (!r.counter_error().empty())
+    std::cerr << "some hardware counters unavailable: " << r.counter_error() << '\n';
+  r.print_events(std::cerr);
+  if (work.tokens == 0)
+    return;
+
+  std::cerr << "per token:\n" << std::fixed << std::setprecision(3);
+  for (int e = 0; e < num_perf_events; ++e)
+    std::cerr << std::setw(16) << perf_event_name((Perf_event)e);
+  std::cerr << "  phase\n";
+  for (char const* name : {"lex", "parse", "dump"}) {
+    Time_phase const* p = r.find(name);
+    if (!p)
+      continue;
+    for (int e = 0; e < num_perf_events; ++e) {
+      if (r.counted_events() & (1u << e))
+        std::cerr << std::setw(16) << (double)p->events.values[e] / work.tokens;
+      else
+        std::cerr << std::setw(16) << '-';
+    }
+    std::cerr << "  " << name << '\n';
+  }
+}
+
+// Parses `p` one declaration at a time, dumping each declaration and then
+// discarding it, so the whole file is never in memory. Lexing is done as
+// needed while parsing, so its time is part of that of parsing.
+static void stream_file(Language lang, Translation& trans, std::filesystem::path const& p, std::ostream& os, Dump_format format, std::size_t max_depth, Compile_stats& work, Parse_profile* profile)
+{
+  std::ifstream ifs(p, std::ios::binary);
+  if (!ifs)
+    throw std::runtime_error("cannot open input file");
+  std::unique_ptr<Parser> parser = make_stream_parser(lang, trans, p, ifs);
+  parser->set_max_depth(max_depth);
+  while (true) {
+    Syntax* s;
+    {
+      Timer timer(trans.time_report(), "parse");
+      Timer variant(trans.time_report(), language_name(lang));
+      s = parser->parse_next();
+    }
+    if (!s)
+      break;
+    dump_tree(trans, s, os, format, work);
+    destroy_tree(trans, s);
+  }
+  add_profile(profile, *parser);
+}
+
+// Appends `arg` to `args`. An argument `@file` is replaced by the arguments
+// in the response file `file`, which are separated by whitespace and may
+// themselves name response files.
+static void add_argument(std::vector<std::string>& args, std::string const& arg, int depth = 0)
+{
+  if (arg.size() < 2 || arg[0] != '@') {
+    args.push_back(arg);
+    return;
+  }
+  if (depth == 16)
+    throw std::runtime_error("response files nested too deeply");
+  std::ifstream ifs(arg.substr(1));
+  if (!ifs)
+    throw std::runtime_error("cannot open response file");
+  std::string word;
+  while (ifs >> word)
+    add_argument(args, word, depth + 1);
+}
+
+// Returns true if `p` names a Beaker source file.
+static bool is_source_file(std::filesystem::path const& p)
+{
+  auto ext = p.extension();
+  return ext == ".bkr" || ext == ".bkr1" || ext == ".bkr2" || ext == ".bkr3" || ext == ".bkr4";
+}
+
+// Appends the input files named by `arg` to `inputs`. A directory names
+// the source files in it and its subdirectories, and a pattern containing
+// `*`, `?`, or `[` names the files matching it. Files are added in sorted
+// order, so the order of inputs doesn't depend on the file system.
+static void add_inputs(std::vector<std::filesystem::path>& inputs, std::string const& arg)
+{
+  if (arg.find_first_of("*?[") != std::string::npos) {
+    glob_t g;
+    if (glob(arg.c_str(), 0, nullptr, &g) != 0)
+      throw std::runtime_error("no files match '" + arg + "'");
+    for (std::size_t i = 0; i < g.gl_pathc; ++i)
+      inputs.push_back(std::filesystem::canonical(g.gl_pathv[i]));
+    globfree(&g);
+    return;
+  }
+
+  // A missing file is still added, so that it is diagnosed along with the
+  // errors of the other inputs.
+  std::filesystem::path p = std::filesystem::weakly_canonical(arg);
+  if (!std::filesystem::is_directory(p)) {
+    inputs.push_back(p);
+    return;
+  }
+  std::vector<std::filesystem::path> files;
+  for (auto const& entry : std::filesystem::recursive_directory_iterator(p))
+    if (entry.is_regular_file() && is_source_file(entry.path()))
+      files.push_back(entry.path());
+  std::sort(files.begin(), files.end());
+  inputs.insert(inputs.end(), files.begin(), files.end());
+}
+
+// The diagnostics and dumped tree of one of several inputs.
+struct File_output
+{
+  std::string diags;
+  std::string tree;
+  bool failed;
+};
+
+// A worker compiling inputs. Each worker has its own translation and keeps
+// a parser for each language, which is reset for each of its inputs. The
+// compile server keeps its workers, so their parsers stay warm.
+struct Worker
+{
+  std::unique_ptr<Translation> trans;
+  std::unique_ptr<Parser> parsers[archive_lang];
+  std::unique_ptr<Time_report> times;
+  Compile_stats work;
+  bool started = false; // True once the worker has run in this command.
+};
+
+// Returns the key of `text` parsed in `lang` with the nesting limit
+// `max_depth`, or an empty string if trees parsed with deferred bodies,
+// which can't be serialized until they're parsed, are requested.
+static std::string tree_cache_key(Tree_cache& cache, std::string_view text, Language lang, bool lazy, std::size_t max_depth)
+{
+  if (lazy)
+    return {};
+  return cache.key(text, language_name(lang), "max-nesting=" + std::to_string(max_depth));
+}
+
+// Returns the tree stored in `cache` for `key`, whose text has `size` bytes,
+// or null if there is none. Its diagnostics are reported to `trans`, and its
+// tokens are added to `work`.
+static Syntax* load_cached_tree(Tree_cache& cache, std::string const& key, std::size_t size, Translation& trans, Compile_stats& work)
+{
+  Timer timer(trans.time_report(), "load cached tree");
+  Tree_cache::Entry e;
+  if (!cache.load(key, size, trans, e))
+    return nullptr;
+  for (Diagnostic const& diag : e.diags)
+    trans.diagnostics().error(diag.location, diag.message);
+  work.tokens += e.tokens;
+  return e.tree;
+}
+
+// Stores the tree `s` parsed by `p` in `cache` for `key`, with the
+// diagnostics of `trans`.
+static void store_cached_tree(Tree_cache& cache, std::string const& key, std::size_t size, Translation& trans, Syntax* s, Parser const& p)
+{
+  Timer timer(trans.time_report(), "store cached tree");
+  cache.store(key, size, {s, trans.diagnostics().m_diags, p.tokens()->toks.size()});
+}
+
+// Parses `text`, the contents of the source file `p`, with the warm parser
+// of `worker` for `lang`, if it has one. If `cache` is non-null, the tree is
+// loaded from it if it has one for the text, or stored in it otherwise.
+static Syntax* parse_source(Worker& worker,
+                            Language lang,
+                            std::filesystem::path const& p,
+                            std::string text,
+                            bool lazy,
+                            std::size_t max_depth,
+                            std::size_t jobs,
+                            Tree_cache* cache)
+{
+  Translation& trans = *worker.trans;
+  std::string key;
+  std::size_t size = text.size();
+  if (cache) {
+    key = tree_cache_key(*cache, text, lang, lazy, max_depth);
+    if (!key.empty())
+      if (Syntax* s = load_cached_tree(*cache, key, size, trans, worker.work))
+        return s;
+  }
+
+  std::unique_ptr<Parser>& parser = worker.parsers[lang];
+  if (parser)
+    parser->reset(p, std::move(text));
+  else
+    parser = make_parser(lang, trans, p, std::move(text));
+  parser->set_jobs(jobs);
+  parser->set_lazy(lazy);
+  parser->set_max_depth(max_depth);
+  Syntax* s = parse_input(lang, trans, *parser);
+  worker.work.add_tokens(*parser);
+  if (!key.empty())
+    store_cached_tree(*cache, key, size, trans, s, *parser);
+  return s;
+}
+
+// The trees of source files parsed by the compile server, keyed by path,
+// grammar, and parse options. An entry is valid while its file has the
+// same modification time and size, or the same size and hash of its text,
+// so a file touched without being changed is not parsed again. When the
+// files of the entries hold more than `m_limit` bytes, the least recently
+// used entries are evicted.
+struct Parse_cache
+{
+  struct Entry
+  {
+    Entry() = default;
+    Entry(Entry const&) = delete;
+
+    ~Entry()
+    {
+      destroy(tree);
+    }
+
+    std::filesystem::file_time_type mtime; // Guarded by the cache's mutex.
+    std::uintmax_t size;
+    std::uint64_t hash;
+    Syntax* tree = nullptr;
+    std::vector<Diagnostic> diags;
+    std::size_t tokens;
+  };
+
+  /// Returns the entry for `key` if its file had the time `mtime` and
+  /// `size` bytes when parsed.
+  std::shared_ptr<Entry const> find(std::string const& key, std::filesystem::file_time_type mtime, std::uintmax_t size)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_entries.find(key);
+    if (iter == m_entries.end() || iter->second.entry->mtime != mtime || iter->second.entry->size != size)
+      return nullptr;
+    touch(iter->second);
+    return iter->second.entry;
+  }
+
+  /// Returns the entry for `key` if its text had `size` bytes and the hash
+  /// `hash`, and updates its time to `mtime`.
+  std::shared_ptr<Entry const> find(std::string const& key, std::filesystem::file_time_type mtime, std::uintmax_t size, std::uint64_t hash)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_entries.find(key);
+    if (iter == m_entries.end() || iter->second.entry->size != size || iter->second.entry->hash != hash)
+      return nullptr;
+    iter->second.entry->mtime = mtime;
+    touch(iter->second);
+    return iter->second.entry;
+  }
+
+  /// Adds or replaces the entry for `key`, and evicts the least recently
+  /// used entries beyond the limit. The newest entry is kept even if it
+  /// exceeds the limit by itself. Replaced and evicted entries are destroyed
+  /// when no command is using them.
+  void insert(std::string const& key, std::shared_ptr<Entry> e)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto [iter, added] = m_entries.try_emplace(key);
+    Slot& slot = iter->second;
+    if (added) {
+      m_order.push_front(key);
+      slot.use = m_order.begin();
+    }
+    else {
+      m_bytes -= slot.entry->size;
+      touch(slot);
+    }
+    m_bytes += e->size;
+    slot.entry = std::move(e);
+    while (m_bytes > m_limit && m_order.size() > 1) {
+      auto victim = m_entries.find(m_order.back());
+      m_bytes -= victim->second.entry->size;
+      m_entries.erase(victim);
+      m_order.pop_back();
+    }
+  }
+
+  /// An entry and its place in the order of use.
+  struct Slot
+  {
+    std::shared_ptr<Entry> entry;
+    std::list<std::string>::iterator use;
+  };
+
+  /// Marks `slot` as the most recently used.
+  void touch(Slot& slot)
+  {
+    m_order.splice(m_order.begin(), m_order, slot.use);
+  }
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, Slot> m_entries;
+  std::list<std::string> m_order; // Keys, most recently used first.
+  std::uintmax_t m_bytes = 0;
+  std::uintmax_t m_limit = std::uintmax_t(64) << 20;
+};
+
+// Returns the tree of the source file `p`, from `cache` if it holds a tree
+// of the same text parsed with the same grammar and options, and otherwise
+// parsed by `worker` and added to the cache. The diagnostics of the parse
+// are reported to the worker's translation either way. Bodies are never
+// deferred, since the tree is shared by later commands, and accessing a
+// deferred body modifies it. Trees that are not in `cache` are parsed or
+// loaded from `trees`, if it is non-null.
+static std::shared_ptr<Parse_cache::Entry const> parse_cached(Parse_cache& cache,
+                                                             Worker& worker,
+                                                             Language lang,
+                                                             std::filesystem::path const& p,
+                                                             std::size_t max_depth,
+                                                             std::size_t jobs,
+                                                             Tree_cache* trees)
+{
+  Translation& trans = *worker.trans;
+  std::string key = std::string(language_name(lang)) + ' ' + std::to_string(max_depth) + ' ' + p.string();
+  std::filesystem::file_time_type mtime = std::filesystem::last_write_time(p);
+  std::shared_ptr<Parse_cache::Entry const> e = cache.find(key, mtime, std::filesystem::file_size(p));
+  if (!e) {
+    std::string text = read_input(trans, p);
+    std::uint64_t hash = hash_text(text);
+    e = cache.find(key, mtime, text.size(), hash);
+    if (!e) {
+      auto entry = std::make_shared<Parse_cache::Entry>();
+      entry->mtime = mtime;
+      entry->size = text.size();
+      entry->hash = hash;
+      std::size_t tokens = worker.work.tokens;
+      entry->tree = parse_source(worker, lang, p, std::move(text), false, max_depth, jobs, trees);
+      entry->diags = trans.diagnostics().m_diags;
+      entry->tokens = worker.work.tokens - tokens;
+      cache.insert(key, entry);
+      return entry;
+    }
+  }
+  for (Diagnostic const& diag : e->diags)
+    trans.diagnostics().error(diag.location, diag.message);
+  worker.work.tokens += e->tokens;
+  return e;
+}
+
+// The state kept by the compile server across commands.
+struct Compile_server
+{
+  std::shared_ptr<Symbol_table> syms = std::make_shared<Symbol_table>();
+  std::vector<Worker> workers;
+  Parse_cache cache;
+
+  // The size of the stack on which commands are run.
+  std::size_t stack;
+};
+
+// Parses each of `inputs` using up to `jobs` workers, whose threads have
+// stacks of `stack` bytes. Trees are dumped to `os` and diagnostics to
+// stderr in the order of the inputs, as soon as those of all preceding
+// inputs have been written. When there are several inputs, diagnostics
+// are prefixed by their file. A single input is parsed by `jobs` workers.
+// Returns true if no errors were reported.
+//
+// If `report` is non-null, each worker times its phases, and their times
+// are added to `report` when all inputs are done. If `trace` is non-null,
+// each input and the phases of compiling it are recorded in it. If `profile`
+// is non-null, the costs of the productions parsed are added to it.
+//
+// If `server` is non-null, its symbols and workers are used, and trees are
+// taken from and added to its cache, unless bodies are deferred. If `trees`
+// is non-null, trees are loaded from and stored in it.
+static bool compile_files(std::span<std::filesystem::path const> inputs,
+                          Language lang,
+                          Dump_format format,
+                          bool lazy,
+                          std::size_t max_depth,
+                          std::size_t jobs,
+                          std::size_t stack,
+                          Time_report* report,
+                          Trace* trace,
+                          Parse_profile* profile,
+                          Compile_stats& work,
+                          std::ostream& os,
+                          Compile_server* server,
+                          Tree_cache* trees)
+{
+  // Symbols are shared by the workers.
+  std::shared_ptr<Symbol_table> syms = server ? server->syms : std::make_shared<Symbol_table>();
+  std::vector<Worker> local;
+  std::vector<Worker>& workers = server ? server->workers : local;
+  std::size_t num_workers = std::min(effective_jobs(jobs), inputs.size());
+  if (workers.size() < num_workers)
+    workers.resize(num_workers);
+  for (Worker& worker : workers)
+    worker.started = false;
+  bool prefix = inputs.size() > 1;
+  std::size_t parse_jobs = inputs.size() == 1 ? jobs : 1;
+
+  // Claim the largest inputs first, so that one claimed last doesn't keep
+  // a single worker busy after the others have finished.
+  std::vector<std::size_t> order(inputs.size());
+  std::vector<std::uintmax_t> sizes(inputs.size());
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    std::error_code ec;
+    order[i] = i;
+    sizes[i] = std::filesystem::file_size(inputs[i], ec);
+    if (ec)
+      sizes[i] = 0;
+  }
+  std::stable_sort(order.begin(), order.end(), [&sizes](std::size_t a, std::size_t b) {
+    return sizes[a] > sizes[b];
+  });
+
+  std::mutex mutex;
+  std::vector<std::optional<File_output>> outputs(inputs.size());
+  std::size_t next = 0;
+  bool ok = true;
+
+  // Records the output of the input `i`, and writes those of the inputs
+  // before it that are finished.
+  auto finish = [&](std::size_t i, File_output out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    outputs[i] = std::move(out);
+    for (; next < outputs.size() && outputs[next]; ++next) {
+      std::cerr << outputs[next]->diags;
+      os << outputs[next]->tree;
+      ok = ok && !outputs[next]->failed;
+      outputs[next].reset();
+    }
+  };
+
+  parallel_for(inputs.size(), num_workers, [&](std::size_t w, std::size_t n) {
+    std::size_t i = order[n];
+    std::filesystem::path const& p = inputs[i];
+    if (!std::filesystem::exists(p)) {
+      finish(i, {"error: no such file '" + p.string() + "'\n", "", true});
+      return;
+    }
+    Worker& worker = workers[w];
+    if (!worker.trans)
+      worker.trans = std::make_unique<Translation>(syms);
+    if (!worker.started) {
+      worker.started = true;
+      worker.work = Compile_stats();
+      if (work.nodes)
+        worker.work.nodes.emplace();
+      worker.trans->set_trace(trace);
+      worker.times.reset();
+      if (report) {
+        worker.times = std::make_unique<Time_report>();
+        worker.times->set_trace(trace);
+        if (report->counts_events())
+          worker.times->count_events();
+      }
+      worker.trans->set_time_report(worker.times.get());
+    }
+    Translation& trans = *worker.trans;
+    Trace_span span(trace, p.filename().string(), "path", p.string());
+
+    Language l = lang == default_lang ? infer_language(p) : lang;
+    Syntax* syn;
+    std::shared_ptr<Parse_cache::Entry const> cached;
+    if (l == archive_lang) {
+      Syntax_archive archive(p);
+      syn = archive.read(trans);
+    }
+    else if (server && !lazy) {
+      cached = parse_cached(server->cache, worker, l, p, max_depth, parse_jobs, trees);
+      syn = cached->tree;
+      worker.work.bytes += sizes[i];
+    }
+    else {
+      syn = parse_source(worker, l, p, read_input(trans, p), lazy, max_depth, parse_jobs, trees);
+      worker.work.bytes += sizes[i];
+    }
+
+    File_output out;
+    std::ostringstream diags;
+    for (Diagnostic const& diag : trans.diagnostics().diagnostics()) {
+      if (prefix)
+        diags << p.string() << ':';
+      diags << diag << '\n';
+    }
+    out.diags = diags.str();
+    out.failed = !trans.diagnostics().empty();
+    trans.diagnostics().m_diags.clear();
+    std::ostringstream tree;
+    dump_tree(trans, syn, tree, format, worker.work);
+    out.tree = tree.str();
+    if (!cached)
+      destroy_tree(trans, syn);
+    finish(i, std::move(out));
+  }, stack);
+  std::cerr.flush();
+  os.flush();
+
+  for (Worker& worker : workers) {
+    if (!worker.started)
+      continue;
+    if (worker.times)
+      report->merge(*worker.times);
+    work.merge(worker.work);
+    for (std::unique_ptr<Parser> const& p : worker.parsers)
+      if (p)
+        add_profile(profile, *p);
+    worker.trans->set_time_report(nullptr);
+    worker.trans->set_trace(nullptr);
+    worker.times.reset();
+  }
+  work.symbols = syms->stats();
+  return ok;
+}
+
+// The largest depth accepted by -max-nesting. Commands run on a stack of
+// 16 KiB per level of nesting, so this limits it to 1 GiB.
+constexpr std::size_t max_nesting_limit = 1 << 16;
 
+// Runs the command whose arguments are `args`, returning its exit status.
+// If `server` is non-null, the command is run by the compile server, which
+// parses source files with its warm workers and cache.
+static int run_command(std::vector<std::string> const& args, Compile_server* server)
+{
   // The input file(s).
   std::vector<std::filesystem::path> inputs;
 
@@ -85,38 +845,424 @@ int main(int argc, char* argv[])
   //    beaker-compile module ...
 
   Language lang = default_lang;
-  for (int i = 1; i < argc; ++i) {
-    std::string arg = argv[i];
+
+  // The output file for the serialized syntax tree, if any.
+  std::filesystem::path ast_output;
+
+  // The format and destination of the dumped tree. By default, the tree
+  // is written to stderr.
+  Dump_format format = Dump_format::text;
+  std::filesystem::path output;
+
+  // The number of jobs used to parse. Zero uses every hardware thread. By
+  // default, a single input is parsed by one job, and several inputs are
+  // parsed by one job per hardware thread.
+  std::optional<std::size_t> jobs;
+
+  // If true, skip the bodies of definitions.
+  bool lazy = false;
+
+  // If true, parse and dump one declaration at a time.
+  bool stream = false;
+
+  // The maximum depth of nested brackets and prefix operators.
+  std::size_t max_depth = Parser::default_max_depth;
+
+  // If true, report the parse costs of each input instead of dumping it.
+  bool compare = false;
+
+  // If true, report the time spent in each phase of compilation.
+  bool time_report = false;
+
+  // If true, report the memory used by each kind of data.
+  bool stats = false;
+
+  // If true, report the costs of each production of the parser.
+  bool parse_profile = false;
+
+  // The directory in which parse results are cached, if any, and the most
+  // it may hold.
+  std::filesystem::path cache_dir;
+  std::uintmax_t cache_size = std::uintmax_t(256) << 20;
+
+  // If true, count hardware events in each phase of compilation.
+  bool perf_counters = false;
+
+  // The file to which a trace of compilation is written, if any.
+  std::filesystem::path trace_output;
+
+  // The previous contents of the input, if it is to be reparsed from them.
+  std::filesystem::path reparse_base;
+
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    std::string const& arg = args[i];
     if (arg[0] == '-') {
       if (arg == "-language") {
-        lang = parse_language(++i, argc, argv);
+        lang = parse_language(++i, args);
+      }
+      else if (arg == "-emit-ast") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing output file");
+        ast_output = args[i];
+      }
+      else if (arg == "-dump") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing dump format");
+        if (!parse_dump_format(args[i], format))
+          throw std::runtime_error("invalid dump format");
+      }
+      else if (arg == "-jobs") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing job count");
+        jobs = std::stoul(args[i]);
+      }
+      else if (arg == "-max-nesting") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing nesting depth");
+        max_depth = std::stoul(args[i]);
+        if (max_depth > max_nesting_limit)
+          throw std::runtime_error("nesting depth too large");
+      }
+      else if (arg == "-lazy-bodies") {
+        lazy = true;
+      }
+      else if (arg == "-stream") {
+        stream = true;
+      }
+      else if (arg == "-compare-grammars") {
+        compare = true;
+      }
+      else if (arg == "-time-report") {
+        time_report = true;
+      }
+      else if (arg == "-stats") {
+        stats = true;
+      }
+      else if (arg == "-parse-profile") {
+#ifndef BEAKER_PARSER_PROFILE
+        throw std::runtime_error("-parse-profile requires building with BEAKER_PARSER_PROFILE");
+#endif
+        parse_profile = true;
+      }
+      else if (arg == "-cache-dir") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing cache directory");
+        cache_dir = args[i];
+      }
+      else if (arg == "-cache-size") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing cache size");
+        cache_size = std::uintmax_t(std::stoull(args[i])) << 20;
+      }
+      else if (arg == "-perf-counters") {
+        perf_counters = true;
+      }
+      else if (arg.starts_with("-trace=")) {
+        trace_output = arg.substr(7);
+        if (trace_output.empty())
+          throw std::runtime_error("missing trace file");
+      }
+      else if (arg == "-reparse") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing previous input");
+        reparse_base = args[i];
+      }
+      else if (arg == "-o") {
+        if (++i >= args.size())
+          throw std::runtime_error("missing output file");
+        output = args[i];
+      }
+      else {
+        throw std::runtime_error("invalid option");
       }
-      throw std::runtime_error("invalid option");
     }
     else {
-      // FIXME: Check to see if the file exists before canonicalizing. Or
-      // trap the exception and diagnose the error.
-      std::filesystem::path p = argv[i];
-      inputs.push_back(std::filesystem::canonical(p));
+      add_inputs(inputs, arg);
     }
   }
   
-  if (inputs.empty())
-    throw std::runtime_error("no inputs given");
-  if (inputs.size() > 1)
-    throw std::runtime_error("only one input allowed");
+  // Parsing and dumping recurse on nested terms, so run them on a stack
+  // that is large enough for the deepest nesting that the parser accepts.
+  // Trees nested only through binary operators can be deeper still.
+  std::size_t stack_size = std::max<std::size_t>(256 << 20, max_depth * (16 << 10));
+
+  // The times and allocations of each phase, if requested, and the amount
+  // of input.
+  std::unique_ptr<Time_report> report;
+  if (time_report || stats || perf_counters || !trace_output.empty())
+    report = std::make_unique<Time_report>();
+  if (perf_counters)
+    report->count_events();
+
+  // The trace of each thread's phases, inputs, and declarations, if
+  // requested. Phases are traced by the time report.
+  std::unique_ptr<Trace> trace;
+  if (!trace_output.empty()) {
+    trace = std::make_unique<Trace>();
+    report->set_trace(trace.get());
+  }
+  Compile_stats work;
+  if (stats)
+    work.nodes.emplace();
+
+  // The cache of parse results, if requested.
+  std::unique_ptr<Tree_cache> tree_cache;
+  if (!cache_dir.empty())
+    tree_cache = std::make_unique<Tree_cache>(cache_dir, cache_size, build_id());
+
+  // The costs of each production, if requested.
+  std::unique_ptr<Parse_profile> profile;
+  if (parse_profile)
+    profile = std::make_unique<Parse_profile>();
+
+  auto compile = [&]() -> int {
+    if (inputs.empty())
+      throw std::runtime_error("no inputs given");
+
+    // Parse each input with the grammar for its extension, or with the one
+    // given by -language, and compare their costs.
+    if (compare) {
+      std::vector<Grammar_input> grammars;
+      for (std::filesystem::path const& p : inputs) {
+        Language l = lang == default_lang ? infer_language(p) : lang;
+        if (l == archive_lang)
+          throw std::runtime_error("cannot compare an archive");
+        if (!std::filesystem::exists(p))
+          throw std::runtime_error("no such file '" + p.string() + "'");
+        grammars.push_back({language_name(l), p, [l, p, max_depth](Translation& t) {
+          std::unique_ptr<Parser> parser = make_parser(l, t, p);
+          parser->set_max_depth(max_depth);
+          return parser;
+        }});
+      }
+      return compare_grammars(grammars, std::cout) ? 0 : 1;
+    }
+
+    // Parse several inputs concurrently, and dump their trees in order. The
+    // server compiles a single input the same way, to use its cache.
+    bool single = inputs.size() == 1;
+    if (!single && !reparse_base.empty())
+      throw std::runtime_error("cannot reparse several inputs");
+    if (!single || (server && !stream && ast_output.empty() && reparse_base.empty() &&
+                    (lang != default_lang ? lang : infer_language(inputs[0])) != archive_lang)) {
+      if (stream)
+        throw std::runtime_error("cannot stream several inputs");
+      if (!ast_output.empty())
+        throw std::runtime_error("cannot emit an archive for several inputs");
+      bool ok;
+      if (!output.empty()) {
+        std::ofstream ofs(output, std::ios::binary);
+        if (!ofs)
+          throw std::runtime_error("cannot open output file");
+        ok = compile_files(inputs, lang, format, lazy, max_depth, jobs.value_or(single ? 1 : 0), stack_size, report.get(), trace.get(), profile.get(), work, ofs, server, tree_cache.get());
+        close_output(ofs);
+      }
+      else {
+        ok = compile_files(inputs, lang, format, lazy, max_depth, jobs.value_or(single ? 1 : 0), stack_size, report.get(), trace.get(), profile.get(), work, std::cerr, server, tree_cache.get());
+      }
+      return ok ? 0 : 1;
+    }
+
+    if (!std::filesystem::exists(inputs[0]))
+      throw std::runtime_error("no such file '" + inputs[0].string() + "'");
+
+    // If no language was specified, try inferring the language from
+    // the file extension.
+    if (lang == default_lang)
+      lang = infer_language(inputs[0]);
 
-  // If no language was specified, try inferring the language from
-  // the file extension.
-  if (lang == default_lang)
-    lang = infer_language(inputs[0]);
+    // The server's commands share its symbol table.
+    Translation trans(server ? server->syms : std::make_shared<Symbol_table>());
+    trans.set_time_report(report.get());
+    trans.set_trace(trace.get());
+    Trace_span span(trace.get(), inputs[0].filename().string(), "path", inputs[0].string());
 
-  Translation trans;
+    // Dump each declaration as it is parsed. Declarations are dumped as
+    // separate trees.
+    if (stream) {
+      if (lang == archive_lang)
+        throw std::runtime_error("cannot stream an archive");
+      if (!reparse_base.empty())
+        throw std::runtime_error("cannot stream a reparse");
+      if (!ast_output.empty())
+        throw std::runtime_error("cannot stream to an archive");
+      if (!output.empty()) {
+        std::ofstream ofs(output, std::ios::binary);
+        if (!ofs)
+          throw std::runtime_error("cannot open output file");
+        stream_file(lang, trans, inputs[0], ofs, format, max_depth, work, profile.get());
+        close_output(ofs);
+      }
+      else {
+        stream_file(lang, trans, inputs[0], std::cerr, format, max_depth, work, profile.get());
+      }
+      work.bytes = std::filesystem::file_size(inputs[0]);
+      work.symbols = trans.symbol_table().stats();
+      trans.diagnostics().print(std::cerr);
+      return trans.diagnostics().empty() ? 0 : 1;
+    }
 
-  // Parse the input file.
-  std::unique_ptr<Parser> parser = make_parser(lang, trans, inputs[0]);
-  Syntax* syn = parser->parse_file();
-  syn->dump();
+    // Parse the input file, or load a previously serialized tree.
+    Syntax* syn;
+    std::unique_ptr<Parser> parser;
+    if (lang == archive_lang) {
+      if (!reparse_base.empty())
+        throw std::runtime_error("cannot reparse an archive");
+      Timer timer(report.get(), "read archive");
+      Syntax_archive archive(inputs[0]);
+      syn = archive.read(trans);
+    }
+    else {
+      std::string text = read_input(trans, inputs[0]);
+      std::size_t size = text.size();
+      std::string key;
+      syn = nullptr;
+      // A reparse reports only the diagnostics of reparsed declarations, so
+      // its tree is neither loaded from nor stored in the cache.
+      if (tree_cache && reparse_base.empty()) {
+        key = tree_cache_key(*tree_cache, text, lang, lazy, max_depth);
+        if (!key.empty())
+          syn = load_cached_tree(*tree_cache, key, size, trans, work);
+      }
+      if (!syn) {
+        bool incremental = !reparse_base.empty();
+        parser = make_parser(lang, trans, inputs[0], incremental ? read_input(trans, reparse_base) : std::move(text));
+        parser->set_jobs(jobs.value_or(1));
+        parser->set_lazy(lazy);
+        parser->set_max_depth(max_depth);
+        if (incremental)
+          syn = reparse_input(lang, trans, *parser, inputs[0], text);
+        else
+          syn = parse_input(lang, trans, *parser);
+        work.add_tokens(*parser);
+        if (!key.empty())
+          store_cached_tree(*tree_cache, key, size, trans, syn, *parser);
+      }
+      work.bytes = size;
+    }
 
-  return 0;
+    // Report all syntax errors. The tree is still dumped, with error nodes
+    // marking where parsing recovered.
+    trans.diagnostics().print(std::cerr);
+
+    if (!ast_output.empty()) {
+      Timer timer(report.get(), "write archive");
+      serialize(syn, ast_output);
+      work.add_nodes(syn);
+    }
+    else if (!output.empty()) {
+      std::ofstream ofs(output, std::ios::binary);
+      if (!ofs)
+        throw std::runtime_error("cannot open output file");
+      dump_tree(trans, syn, ofs, format, work);
+      close_output(ofs);
+    }
+    else {
+      dump_tree(trans, syn, std::cerr, format, work);
+    }
+
+    if (parser)
+      add_profile(profile.get(), *parser);
+    work.symbols = trans.symbol_table().stats();
+
+    // The tree is left for the process to reclaim when it exits, but the
+    // parser's tokens and tables are freed. The server keeps running, so
+    // it frees the tree too.
+    {
+      Timer timer(report.get(), "teardown");
+      if (server)
+        destroy_indexed(trans, syn);
+      parser.reset();
+    }
+
+    return trans.diagnostics().empty() ? 0 : 1;
+  };
+
+  // Keep the cache within its limit once all trees have been stored.
+  auto compile_and_trim = [&]() -> int {
+    int status = compile();
+    if (tree_cache && tree_cache->m_stores != 0) {
+      Timer timer(report.get(), "trim cache");
+      tree_cache->trim();
+    }
+    return status;
+  };
+
+  // The server runs commands on a large stack already.
+  int status = 0;
+  if (server && stack_size <= server->stack) {
+    status = compile_and_trim();
+  }
+  else {
+    call_with_stack(stack_size, [&] {
+      status = compile_and_trim();
+    });
+  }
+  if (trace) {
+    std::ofstream ofs(trace_output);
+    if (!ofs)
+      throw std::runtime_error("cannot open trace file");
+    trace->write(ofs);
+  }
+  if (time_report)
+    print_time_report(*report, work);
+  if (stats)
+    print_stats(*report, work, tree_cache.get());
+  if (perf_counters)
+    print_perf_counters(*report, work);
+  if (profile) {
+    std::cerr << "===-- parse profile --===\n";
+    profile->print(std::cerr);
+  }
+  return status;
+}
+
+// Runs the command in `argv`, returning its exit status.
+static int run_main(int argc, char* argv[])
+{
+  if (argc == 1)
+    throw std::runtime_error("usage error");
+
+  // Expand response files.
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i)
+    add_argument(args, argv[i]);
+
+  // With -server <socket>, serve commands sent by clients. With -connect
+  // <socket>, send this command to a server.
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    if (args[i] != "-server" && args[i] != "-connect")
+      continue;
+    if (i + 1 >= args.size())
+      throw std::runtime_error("missing socket");
+    bool serving = args[i] == "-server";
+    std::filesystem::path socket = args[i + 1];
+    args.erase(args.begin() + i, args.begin() + i + 2);
+    if (!serving)
+      return send_command(socket, args, std::cout, std::cerr);
+    if (!args.empty())
+      throw std::runtime_error("-server takes no other arguments");
+    Compile_server server;
+    server.stack = std::max<std::size_t>(256 << 20, Parser::default_max_depth * (16 << 10));
+    call_with_stack(server.stack, [&] {
+      serve(socket, [&server](std::vector<std::string> const& args) {
+        return run_command(args, &server);
+      });
+    });
+    return 0;
+  }
+
+  return run_command(args, nullptr);
+}
+
+// Errors are reported the same way as by the compile server.
+int main(int argc, char* argv[])
+{
+  try {
+    return run_main(argc, argv);
+  }
+  catch (std::exception const& e) {
+    std::cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
 }
@@ -0,0 +1,264 @@
+#include "server.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace beaker
+{
+  // Messages are sequences of native integers and length-prefixed strings.
+  // A request is the number of strings, the working directory, and the
+  // arguments. A reply is the exit status, stdout, and stderr.
+
+  // The most strings in a request, and the most bytes in each. Sizes are
+  // read from the socket, so they are checked before anything is allocated
+  // for them.
+  constexpr std::uint64_t max_request_strings = 1 << 16;
+  constexpr std::uint64_t max_request_string = 1 << 20;
+
+  // How long the server waits for a client to send its request, and for
+  // each write of a reply. Requests are handled one at a time, so a stalled
+  // client would otherwise block every other client.
+  constexpr int client_timeout = 10; // In seconds.
+
+  [[noreturn]] static void throw_error(char const* what)
+  {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  // Returns the address of the socket `path`.
+  static sockaddr_un socket_address(std::filesystem::path const& path)
+  {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    std::string const& str = path.native();
+    if (str.size() >= sizeof addr.sun_path)
+      throw std::runtime_error("socket path too long");
+    std::memcpy(addr.sun_path, str.c_str(), str.size());
+    return addr;
+  }
+
+  // Writes the `n` bytes at `p` to `fd`. Returns false if the peer has
+  // closed the connection.
+  static bool write_all(int fd, void const* p, std::size_t n)
+  {
+    char const* buf = static_cast<char const*>(p);
+    while (n != 0) {
+      ssize_t k = send(fd, buf, n, MSG_NOSIGNAL);
+      if (k < 0 && errno == EINTR)
+        continue;
+      if (k <= 0)
+        return false;
+      buf += k;
+      n -= k;
+    }
+    return true;
+  }
+
+  using Deadline = std::chrono::steady_clock::time_point;
+
+  // Waits until `fd` can be read. Returns false if `deadline` passes first.
+  static bool wait_readable(int fd, Deadline deadline)
+  {
+    if (deadline == Deadline::max())
+      return true;
+    while (true) {
+      auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0)
+        return false;
+      pollfd p = {fd, POLLIN, 0};
+      int k = poll(&p, 1, left.count());
+      if (k < 0 && errno == EINTR)
+        continue;
+      return k > 0;
+    }
+  }
+
+  // Reads `n` bytes from `fd` into `p`. Returns false if the peer closed the
+  // connection first, or if `deadline` passed.
+  static bool read_all(int fd, void* p, std::size_t n, Deadline deadline = Deadline::max())
+  {
+    char* buf = static_cast<char*>(p);
+    while (n != 0) {
+      if (!wait_readable(fd, deadline))
+        return false;
+      ssize_t k = recv(fd, buf, n, 0);
+      if (k < 0 && errno == EINTR)
+        continue;
+      if (k <= 0)
+        return false;
+      buf += k;
+      n -= k;
+    }
+    return true;
+  }
+
+  static bool write_string(int fd, std::string const& str)
+  {
+    std::uint64_t n = str.size();
+    return write_all(fd, &n, sizeof n) && write_all(fd, str.data(), n);
+  }
+
+  // Reads a string of at most `max` bytes. Returns false if the string is
+  // longer, if the peer closed the connection first, or if `deadline`
+  // passed.
+  static bool read_string(int fd, std::string& str, std::uint64_t max = -1, Deadline deadline = Deadline::max())
+  {
+    std::uint64_t n;
+    if (!read_all(fd, &n, sizeof n, deadline) || n > max)
+      return false;
+    str.resize(n);
+    return read_all(fd, str.data(), n, deadline);
+  }
+
+  // Closes a file descriptor when it goes out of scope.
+  struct File_descriptor
+  {
+    explicit File_descriptor(int fd)
+      : fd(fd)
+    { }
+
+    File_descriptor(File_descriptor const&) = delete;
+
+    ~File_descriptor()
+    {
+      if (fd >= 0)
+        close(fd);
+    }
+
+    int fd;
+  };
+
+  // Runs the command `args` in the directory `dir`, returning its status
+  // and capturing its output.
+  static int run_command(Server_command const& run,
+                         std::string const& dir,
+                         std::vector<std::string> const& args,
+                         std::ostringstream& out,
+                         std::ostringstream& err)
+  {
+    std::streambuf* cout = std::cout.rdbuf(out.rdbuf());
+    std::streambuf* cerr = std::cerr.rdbuf(err.rdbuf());
+    int status;
+    try {
+      if (chdir(dir.c_str()) != 0)
+        throw_error("cannot change to the client's directory");
+      status = run(args);
+    }
+    catch (std::exception const& e) {
+      std::cerr << "error: " << e.what() << '\n';
+      status = 1;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    std::cout.rdbuf(cout);
+    std::cerr.rdbuf(cerr);
+    return status;
+  }
+
+  void serve(std::filesystem::path const& path, Server_command run)
+  {
+    File_descriptor sock(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (sock.fd < 0)
+      throw_error("cannot create socket");
+
+    // Replace the socket of a server that didn't stop cleanly. The path is
+    // made absolute, since commands change the working directory.
+    sockaddr_un addr = socket_address(std::filesystem::absolute(path));
+    unlink(addr.sun_path);
+    if (bind(sock.fd, (sockaddr const*)&addr, sizeof addr) != 0)
+      throw_error("cannot bind socket");
+    if (listen(sock.fd, SOMAXCONN) != 0)
+      throw_error("cannot listen on socket");
+
+    bool done = false;
+    while (!done) {
+      File_descriptor conn(accept4(sock.fd, nullptr, nullptr, SOCK_CLOEXEC));
+      if (conn.fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED)
+          continue;
+        throw_error("cannot accept connection");
+      }
+      timeval timeout = {client_timeout, 0};
+      setsockopt(conn.fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+
+      // Ignore requests that end early or aren't received in time; the
+      // client has gone or stalled. Drop those that are malformed or too
+      // large.
+      Deadline deadline = std::chrono::steady_clock::now() + std::chrono::seconds(client_timeout);
+      std::uint64_t n;
+      std::string dir;
+      if (!read_all(conn.fd, &n, sizeof n, deadline) || n == 0 || n > max_request_strings ||
+          !read_string(conn.fd, dir, max_request_string, deadline))
+        continue;
+      std::vector<std::string> args(n - 1);
+      bool ok = true;
+      for (std::string& arg : args)
+        ok = ok && read_string(conn.fd, arg, max_request_string, deadline);
+      if (!ok)
+        continue;
+
+      std::int32_t status = 0;
+      std::ostringstream out;
+      std::ostringstream err;
+      if (args.size() == 1 && args[0] == "-shutdown")
+        done = true;
+      else
+        status = run_command(run, dir, args, out, err);
+      write_all(conn.fd, &status, sizeof status) &&
+        write_string(conn.fd, out.str()) &&
+        write_string(conn.fd, err.str());
+    }
+    unlink(addr.sun_path);
+  }
+
+  int send_command(std::filesystem::path const& path,
+                   std::vector<std::string> const& args,
+                   std::ostream& out,
+                   std::ostream& err)
+  {
+    // The server drops requests that exceed its limits.
+    if (args.size() + 1 > max_request_strings)
+      throw std::runtime_error("too many arguments for the server");
+    for (std::string const& arg : args)
+      if (arg.size() > max_request_string)
+        throw std::runtime_error("argument too long for the server");
+
+    File_descriptor sock(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (sock.fd < 0)
+      throw_error("cannot create socket");
+    sockaddr_un addr = socket_address(path);
+    if (connect(sock.fd, (sockaddr const*)&addr, sizeof addr) != 0)
+      throw_error("cannot connect to server");
+
+    std::uint64_t n = args.size() + 1;
+    bool ok = write_all(sock.fd, &n, sizeof n) &&
+              write_string(sock.fd, std::filesystem::current_path().string());
+    for (std::string const& arg : args)
+      ok = ok && write_string(sock.fd, arg);
+
+    std::int32_t status;
+    std::string output;
+    std::string errors;
+    ok = ok && read_all(sock.fd, &status, sizeof status) &&
+         read_string(sock.fd, output) &&
+         read_string(sock.fd, errors);
+    if (!ok)
+      throw std::runtime_error("lost connection to server");
+    out << output;
+    err << errors;
+    return status;
+  }
+
+} // namespace beaker
@@ -0,0 +1,41 @@
+#ifndef BEAKER_TOOLS_COMPILER_SERVER_HPP
+#define BEAKER_TOOLS_COMPILER_SERVER_HPP
+
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace beaker
+{
+  // Compile server
+  //
+  // A server listens on a Unix domain socket for requests, each of which is
+  // the command line of a client and its working directory. The server runs
+  // the command in that directory and replies with the output it wrote to
+  // stdout and stderr and its exit status. Requests are handled one at a
+  // time, so a command may change the working directory and the standard
+  // streams of the process while it runs.
+  //
+  // A request consisting only of `-shutdown` stops the server.
+
+  /// Runs the command `args`, returning its exit status.
+  using Server_command = std::function<int(std::vector<std::string> const& args)>;
+
+  /// Handles requests on the socket `path` by calling `run`, with stdout and
+  /// stderr redirected to the client and the working directory set to that
+  /// of the client, until a client asks the server to stop. An exception
+  /// thrown by a command is reported to its client as an error.
+  void serve(std::filesystem::path const& path, Server_command run);
+
+  /// Sends the command `args` to the server listening on `path`, and writes
+  /// its output to `out` and `err`. Returns the exit status of the command.
+  int send_command(std::filesystem::path const& path,
+                   std::vector<std::string> const& args,
+                   std::ostream& out,
+                   std::ostream& err);
+
+} // namespace beaker
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef BEAKER_TESTS_CHECK_HPP
+#define BEAKER_TESTS_CHECK_HPP
+
+#include <cstdlib>
+#include <iostream>
+
+/// Reports a failed check and exits if `cond` is false.
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #cond "\n"; \
+      std::exit(1); \
+    } \
+  } while (false)
+
+#endif
@@ -0,0 +1,45 @@
+# Checks the JSON dump of tests/inputs/enclosures.bkr. The dump must be valid
+# JSON without duplicate keys, and each enclosure must keep its node kind
+# and report its brackets separately.
+#
+# Usage: check_json_dump.py <beaker-compile> <input>
+
+import collections
+import json
+import subprocess
+import sys
+
+
+def unique_keys(pairs):
+    keys = [k for k, _ in pairs]
+    dups = [k for k, n in collections.Counter(keys).items() if n > 1]
+    if dups:
+        raise ValueError("duplicate keys: " + ", ".join(dups))
+    return dict(pairs)
+
+
+def nodes(node):
+    yield node
+    for child in node["children"]:
+        if child is not None:
+            yield from nodes(child)
+
+
+def main():
+    compiler, path = sys.argv[1], sys.argv[2]
+    out = subprocess.run([compiler, path, "-dump", "json", "-o", "/dev/stdout"],
+                         check=True, capture_output=True, text=True).stdout
+    root = json.loads(out, object_pairs_hook=unique_keys)
+    assert root["kind"] == "File", root["kind"]
+
+    brackets = collections.Counter()
+    for node in nodes(root):
+        if "brackets" in node:
+            assert node["kind"] == "Enclosure", node["kind"]
+            brackets[node["brackets"]] += 1
+    expected = {"()": 3, "[]": 2, "{}": 2}
+    assert brackets == expected, dict(brackets)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,72 @@
+#include "check.hpp"
+
+#include <beaker/frontend/dump.hpp>
+#include <beaker/frontend/first/first_parser.hpp>
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace beaker;
+
+// Returns the initializers of the declarations of `file`.
+static std::vector<Syntax*> initializers(Syntax* file)
+{
+  std::vector<Syntax*> inits;
+  Syntax* decls = static_cast<File_syntax*>(file)->declarations();
+  for (Syntax* d : decls->children())
+    inits.push_back(static_cast<Declaration_syntax*>(d)->initializer());
+  return inits;
+}
+
+static std::string dump_string(Syntax const* s)
+{
+  std::ostringstream os;
+  dump(s, os);
+  return os.str();
+}
+
+int main(int argc, char* argv[])
+{
+  CHECK(argc == 2);
+  std::string text = read_file(argv[1]);
+  Translation trans;
+
+  // Parse the file with its bodies deferred, in parallel and serially.
+  std::vector<Syntax*> trees;
+  for (std::size_t jobs : {4, 1}) {
+    auto p = std::make_unique<First_parser>(trans, argv[1], text);
+    p->set_lazy(true);
+    p->set_jobs(jobs);
+    trees.push_back(p->parse_file());
+
+    // Bodies can be parsed after the parser is reset or destroyed.
+    p->reset("other.bkr", "def x : int = 0;\n");
+    destroy(p->parse_file());
+  }
+
+  First_parser eager(trans, argv[1], text);
+  Syntax* expected = eager.parse_file();
+  CHECK(trans.diagnostics().empty());
+  std::vector<Syntax*> want = initializers(expected);
+  for (Syntax* tree : trees) {
+    std::vector<Syntax*> got = initializers(tree);
+    CHECK(got.size() == want.size());
+    std::size_t deferred = 0;
+    for (std::size_t i = 0; i < got.size(); ++i) {
+      if (!got[i] || got[i]->kind() != Syntax::Deferred)
+        continue;
+      auto* d = static_cast<Deferred_syntax*>(got[i]);
+      CHECK(d->is_deferred());
+      CHECK(want[i]->kind() == Syntax::Enclosure);
+      CHECK(dump_string(d->body()) == dump_string(static_cast<Enclosure_syntax*>(want[i])->term()));
+      CHECK(!d->is_deferred());
+      ++deferred;
+    }
+    CHECK(deferred == 2);
+    destroy(tree);
+  }
+  CHECK(trans.diagnostics().empty());
+  destroy(expected);
+  return 0;
+}
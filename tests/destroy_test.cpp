@@ -0,0 +1,19 @@
+#include "check.hpp"
+
+#include <beaker/frontend/syntax.hpp>
+
+using namespace beaker;
+
+int main()
+{
+  // A tree deeper than the stack would allow a recursive destroy.
+  Syntax* s = nullptr;
+  for (int i = 0; i < 10'000'000; ++i)
+    s = new Prefix_syntax(Token(), s);
+  destroy(s);
+
+  // Null children are skipped.
+  destroy(new Infix_syntax(Token(), nullptr, new Prefix_syntax(Token(), nullptr)));
+  destroy(nullptr);
+  return 0;
+}
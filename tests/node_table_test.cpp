@@ -0,0 +1,74 @@
+#include "check.hpp"
+
+#include <beaker/frontend/first/first_parser.hpp>
+#include <beaker/frontend/node_table.hpp>
+
+#include <vector>
+
+using namespace beaker;
+
+// Checks the entries for `s` and its subtrees against the path of nodes
+// from the root to `s`, and that the nodes are numbered in pre-order.
+static void check_tree(Node_table const& t, Syntax const* s, std::vector<Syntax const*>& path, Node_id& next)
+{
+  Node_id n = t.id(s);
+  CHECK(n == next++);
+  CHECK(t.node(n) == s);
+  CHECK(t.depth(n) == path.size());
+  if (path.empty()) {
+    CHECK(t.parent(n) == no_node);
+    CHECK(t.parent(s) == nullptr);
+  }
+  else {
+    CHECK(t.parent(n) == t.id(path.back()));
+    CHECK(t.parent(s) == path.back());
+  }
+
+  // The nearest enclosing declaration.
+  Syntax const* decl = nullptr;
+  for (Syntax const* a : path)
+    if (a->kind() == Syntax::Declaration)
+      decl = a;
+  CHECK(t.enclosing(s, Syntax::Declaration) == decl);
+
+  path.push_back(s);
+  for (Syntax const* c : s->children())
+    if (c)
+      check_tree(t, c, path, next);
+  path.pop_back();
+}
+
+int main(int argc, char* argv[])
+{
+  CHECK(argc == 2);
+
+  // The table of no tree is empty.
+  Node_table empty(nullptr);
+  CHECK(empty.size() == 0);
+  CHECK(empty.root() == nullptr);
+
+  Translation trans;
+  First_parser p(trans, argv[1]);
+  Syntax* file = p.parse_file();
+  CHECK(file && trans.diagnostics().empty());
+
+  Node_table t(file);
+  CHECK(t.root() == file);
+  CHECK(t.id(file) == 0);
+  std::vector<Syntax const*> path;
+  Node_id next = 0;
+  check_tree(t, file, path, next);
+  CHECK(next == t.size());
+  CHECK(t.size() > 20);
+
+  // Values are found by id and by node.
+  Node_map<Node_id> m(t, no_node);
+  CHECK(m.size() == t.size());
+  for (Node_id n = 0; n < t.size(); ++n)
+    m[t.node(n)] = n;
+  for (Node_id n = 0; n < t.size(); ++n)
+    CHECK(m[n] == n);
+
+  destroy(file);
+  return 0;
+}
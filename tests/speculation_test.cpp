@@ -0,0 +1,104 @@
+#include "check.hpp"
+
+#include <beaker/frontend/second/second_parser.hpp>
+#include <beaker/frontend/syntax.hpp>
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+// Counts live allocations so that the test can check that speculation
+// doesn't leak the trees of failed parses.
+
+static long live_allocations = 0;
+
+void* operator new(std::size_t n)
+{
+  void* p = std::malloc(n ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  ++live_allocations;
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  if (p)
+    --live_allocations;
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  operator delete(p);
+}
+
+using namespace beaker;
+
+// Returns `n` nested parens around `id`.
+static std::string nest(int n, std::string const& id)
+{
+  return std::string(n, '(') + id + std::string(n, ')');
+}
+
+struct Parse
+{
+  std::size_t parses;
+  std::size_t replays;
+  std::size_t errors;
+};
+
+// Parses `text` as a second-grammar file and destroys the tree.
+static Parse parse(std::string const& text, Syntax::Kind type)
+{
+  Translation trans;
+  Second_parser p(trans, "test.bkr2", text);
+  p.set_max_depth(8 * 1000);
+  Syntax* file = p.parse_file();
+  CHECK(file);
+  Parse r{p.m_memo.m_parses, p.m_memo.m_replays, trans.diagnostics().errors()};
+
+  // The declared type is a function type or a parenthesized expression.
+  auto* decls = static_cast<Sequence_syntax*>(static_cast<File_syntax*>(file)->declarations());
+  auto* decl = static_cast<Declaration_syntax*>(decls->operand(0));
+  CHECK(decl->type()->kind() == type);
+  destroy(file);
+  return r;
+}
+
+int main()
+{
+  // Each paren is parsed at most once as a function type and once as a
+  // parenthesized expression; retries after backtracking are replayed.
+  for (int n : {1, 10, 100, 1000}) {
+    std::string fn = "def f : " + nest(n, "a") + " -> int;\n";
+    Parse r = parse(fn, Syntax::Infix);
+    CHECK(r.errors == 0);
+    CHECK(r.parses <= 2 * std::size_t(n) + 1);
+    CHECK(r.replays <= 2 * std::size_t(n));
+
+    std::string expr = "def x : " + nest(n, "a") + ";\n";
+    r = parse(expr, Syntax::Enclosure);
+    CHECK(r.errors == 0);
+    CHECK(r.parses <= 2 * std::size_t(n) + 1);
+    CHECK(r.replays <= 2 * std::size_t(n));
+  }
+
+  // Failed speculations, including ones with errors, free their trees.
+  std::string text = "def f : " + nest(50, "a, (b") + " -> int;\n"
+                     "def x : (" + nest(50, "a") + " + ((b)) -> c;\n"
+                     "def y : ((a) -> ((b)));\n";
+  auto syms = std::make_shared<Symbol_table>();
+  auto run = [&] {
+    Translation trans(syms);
+    Second_parser p(trans, "test.bkr2", text);
+    destroy(p.parse_file());
+    CHECK(trans.diagnostics().errors() != 0);
+  };
+  run(); // Interns the symbols.
+  long before = live_allocations;
+  run();
+  CHECK(live_allocations == before);
+  return 0;
+}
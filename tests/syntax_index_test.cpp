@@ -0,0 +1,81 @@
+#include "check.hpp"
+
+#include <beaker/frontend/first/first_parser.hpp>
+#include <beaker/frontend/syntax_index.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+using namespace beaker;
+
+// Appends the nodes of `s` and its subtrees to `nodes` in pre-order.
+static void collect(Syntax const* s, std::vector<Syntax const*>& nodes)
+{
+  nodes.push_back(s);
+  for (Syntax const* c : s->children())
+    if (c)
+      collect(c, nodes);
+}
+
+// Returns the nodes of kind `k` in `nodes`.
+static std::vector<Syntax const*> of_kind(std::vector<Syntax const*> const& nodes, Syntax::Kind k)
+{
+  std::vector<Syntax const*> r;
+  std::copy_if(nodes.begin(), nodes.end(), std::back_inserter(r), [k](Syntax const* s) {
+    return s->kind() == k;
+  });
+  return r;
+}
+
+static bool equal(Const_syntax_span a, std::vector<Syntax const*> const& b)
+{
+  return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+// Checks the index of `file` against a walk of the tree.
+static void check_index(Translation& trans, Syntax const* file)
+{
+  Syntax_index const& idx = get_syntax_index(trans, file);
+  CHECK(&get_syntax_index(trans, file) == &idx);
+  CHECK(trans.get_index(file) == &idx);
+
+  std::vector<Syntax const*> nodes;
+  collect(file, nodes);
+  for (std::size_t k = 0; k < Syntax_index::num_kinds; ++k) {
+    CHECK(equal(idx.nodes(Syntax::Kind(k)), of_kind(nodes, Syntax::Kind(k))));
+    auto const& starts = idx.m_kinds[k].starts;
+    CHECK(std::is_sorted(starts.begin(), starts.end()));
+  }
+  CHECK(idx.nodes(Syntax::File).size() == 1);
+  CHECK(idx.nodes(Syntax::Enclosure).size() == 7);
+
+  // The identifiers found within a declaration are the ones in it.
+  for (Syntax const* d : idx.nodes(Syntax::Declaration)) {
+    std::vector<Syntax const*> sub;
+    collect(d, sub);
+    CHECK(equal(idx.find(Syntax::Identifier, d->location()), of_kind(sub, Syntax::Identifier)));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  CHECK(argc == 2);
+  Translation trans;
+  First_parser p(trans, argv[1]);
+  Syntax* file = p.parse_file();
+  CHECK(file && trans.diagnostics().empty());
+  check_index(trans, file);
+
+  // Destroying the tree removes its index, so a tree parsed later, which
+  // may be at the same address, is indexed anew.
+  destroy_indexed(trans, file);
+  CHECK(trans.get_index(file) == nullptr);
+  p.reset(argv[1], read_file(argv[1]));
+  file = p.parse_file();
+  CHECK(file && trans.diagnostics().empty());
+  CHECK(trans.get_index(file) == nullptr);
+  check_index(trans, file);
+  destroy_indexed(trans, file);
+  return 0;
+}